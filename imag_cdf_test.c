@@ -15,17 +15,24 @@
 static char cdf_filename [100] = "";
 
 void handle_error (char *err_msg);
+int check_format_fixed ();
+int check_parse_number ();
+int check_find_time_stamp_index ();
 
 
 int main ()
 
 {
-  int count, count2, cdf_handle;
-  char field_name [N_VARS] [40], var_name [40], *elem_ptr, elem_rec [10];
+  int count, count2, cdf_handle, n_var_list;
+  char field_name [N_VARS] [40], *elem_ptr, elem_rec [10];
   double data [N_VARS] [N_SAMPLES], amp_scale, amp_offest, freq_mult, scale;
   struct IMCDFGlobalAttr global_attrs;
   struct IMCDFVariable variable [N_VARS], var;
   struct IMCDFVariableTS time_stamps;
+  struct IMCDFVariableInfo *var_list;
+
+  /* check the text formatting routines, which don't need a CDF file */
+  if (check_format_fixed () + check_parse_number () + check_find_time_stamp_index ()) exit (1);
 
   /* create fake data signals */
   for (count=0; count<N_VARS; count++)
@@ -160,14 +167,15 @@ int main ()
     imcdf_free_variable (&var);
   }
   /* read and print temperature variables */
-  for (count=1; 1; count++)
+  handle_error (imcdf_list_variables (cdf_handle, &var_list, &n_var_list));
+  for (count=0; count<n_var_list; count++)
   {
-    sprintf (elem_rec, "%d", count);
-    if (imcdf_read_variable (cdf_handle, IMCDF_VARTYPE_TEMPERATURE, elem_rec, &var)) break;
-    sprintf (var_name, TEMPERATURE_TIME_STAMPS_VAR_NAME_BASE, elem_rec);
+    if (var_list[count].var_type != IMCDF_VARTYPE_TEMPERATURE) continue;
+    handle_error (imcdf_read_variable (cdf_handle, IMCDF_VARTYPE_TEMPERATURE, var_list[count].elem_rec, &var));
     imcdf_print_variable (&var, &time_stamps);
     imcdf_free_variable (&var);
   }
+  imcdf_free_variable_list (var_list);
   /* tidy up */
   imcdf_free_time_stamps (&time_stamps);
   imcdf_free_global_attrs (&global_attrs);
@@ -187,3 +195,131 @@ void handle_error (char *err_msg)
   }
 }
 
+/* check imcdf_format_fixed () against sprintf for signs, negative zero,
+ * values half way between two results and the full range of decimals -
+ * differences are written to stderr, returns the number found */
+int check_format_fixed ()
+{
+  static double values [] = { 0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 1.5, 2.5, -2.5,
+                              0.125, -0.125, 0.375, 1.005, 2.675, -2.675,
+                              0.0049, -0.0049, 0.05, 0.95, 9.5, 99.5, 999.95,
+                              12345.675, -12345.675, 20000.04, -19.99,
+                              88888.0, 99999.0, 999999.0, 123456789.123456789,
+                              -0.000001, 5.0e-10, 1.0e11, -1.0e13 };
+  static int decimals [] = { 0, 1, 2, 3, 6, 9 };
+  int count, count2, n_errors;
+  char fast [IMCDF_NUMBER_STRING_LEN], slow [IMCDF_NUMBER_STRING_LEN];
+
+  n_errors = 0;
+  for (count=0; count<(int) (sizeof (values) / sizeof (values [0])); count++)
+  {
+    for (count2=0; count2<(int) (sizeof (decimals) / sizeof (decimals [0])); count2++)
+    {
+      imcdf_format_fixed (values [count], decimals [count2], fast);
+      snprintf (slow, sizeof (slow), "%.*f", decimals [count2], values [count]);
+      if (strcmp (fast, slow))
+      {
+        fprintf (stderr, "imcdf_format_fixed (%.17g, %d) gave [%s], sprintf gave [%s]\n",
+                 values [count], decimals [count2], fast, slow);
+        n_errors ++;
+      }
+    }
+  }
+  return n_errors;
+}
+
+/* check imcdf_parse_number () against strtod on the fields of IAGA-2002
+ * and IMF data lines, including the missing and not recorded values, and
+ * on text that holds no number - differences are written to stderr,
+ * returns the number found */
+int check_parse_number ()
+{
+  static char *lines [] = { "     20000.04    -19.99  30000.26  50000.61",
+                            "     99999.00  88888.00  99999.00  88888.00",
+                            "     -0.00     +12.5       0.125  1234567.5",
+                            "  201234 -12345 999999 888888   201244  -0012 999999 888888",
+                            "1 12 123 1234 12345 123456 1234567",
+                            "  0.000000000001   9.999999999999" };
+  static char *no_numbers [] = { "", "      ", "   |", "  -", "  +.", "  ." };
+  int count, n_errors;
+  char *ptr, *end, *expected_end;
+  double value, expected;
+
+  n_errors = 0;
+  for (count=0; count<(int) (sizeof (lines) / sizeof (lines [0])); count++)
+  {
+    ptr = lines [count];
+    end = ptr + strlen (ptr);
+    for (;;)
+    {
+      expected = strtod (ptr, &expected_end);
+      if (expected_end == ptr) break;
+      value = 0.0;
+      if (! imcdf_parse_number (&ptr, end, &value) || value != expected ||
+          signbit (value) != signbit (expected) || ptr != expected_end)
+      {
+        fprintf (stderr, "imcdf_parse_number ([%s]) gave %.17g, strtod gave %.17g\n",
+                 lines [count], value, expected);
+        n_errors ++;
+        break;
+      }
+    }
+  }
+  for (count=0; count<(int) (sizeof (no_numbers) / sizeof (no_numbers [0])); count++)
+  {
+    ptr = no_numbers [count];
+    if (imcdf_parse_number (&ptr, ptr + strlen (ptr), &value))
+    {
+      fprintf (stderr, "imcdf_parse_number ([%s]) found a number\n", no_numbers [count]);
+      n_errors ++;
+    }
+  }
+  return n_errors;
+}
+
+/* check imcdf_find_time_stamp_index () on a compact time axis against the
+ * same time stamps held in an array, for times before, between, on and
+ * after the samples, including the open range limits - the axis starts
+ * in 1980, so its start time is negative. Differences are written to
+ * stderr, returns the number found */
+int check_find_time_stamp_index ()
+{
+  int count, n_errors, compact_index, array_index;
+  long long times [N_SAMPLES * 2 + 6];
+  struct IMCDFVariableTS compact, array;
+
+  array.var_name = compact.var_name = DATA_TIMES_VAR_NAME;
+  array.time_stamps = imcdf_make_tt2000_array (1980, 1, 1, 0, 0, 0, 60, N_SAMPLES);
+  array.data_len = compact.data_len = N_SAMPLES;
+  compact.time_stamps = 0;
+  compact.start = array.time_stamps [0];
+  compact.step = 60000000000ll;
+
+  for (count=0; count<N_SAMPLES; count++)
+  {
+    times [count * 2] = array.time_stamps [count];
+    times [(count * 2) +1] = array.time_stamps [count] + 1;
+  }
+  count = N_SAMPLES * 2;
+  times [count ++] = IMCDF_TT2000_EARLIEST;
+  times [count ++] = IMCDF_TT2000_LATEST;
+  times [count ++] = array.time_stamps [0] -1;
+  times [count ++] = array.time_stamps [N_SAMPLES -1] + compact.step;
+  times [count ++] = 0;
+  times [count ++] = 1;
+
+  n_errors = 0;
+  for (count=0; count<(int) (sizeof (times) / sizeof (times [0])); count++)
+  {
+    compact_index = imcdf_find_time_stamp_index (&compact, times [count]);
+    array_index = imcdf_find_time_stamp_index (&array, times [count]);
+    if (compact_index != array_index)
+    {
+      fprintf (stderr, "imcdf_find_time_stamp_index (%lld) gave %d for a compact axis, %d for an array\n",
+               times [count], compact_index, array_index);
+      n_errors ++;
+    }
+  }
+  imcdf_free_time_stamps (&array);
+  return n_errors;
+}
@@ -12,17 +12,42 @@
  *        Call imcdf_open2 ()
  *        Call imcdf_read_global_attrs () to read the global attributes
  *                and to discover what information is in the file
+ *              (or call imcdf_read_global_attr_set () to read all the global
+ *              attributes in one pass, keeping any that are not part of 
+ *              ImagCDF, and free them with imcdf_free_global_attr_set ())
  *              Use the IMCDFGlobalAttr.elements_recorded field to discover which
- *                geomagnetic elements are recorded in the file. For temparture variables
- *                start at Temperature1 and increment the number calling the read routine
- *                to check whether the variable exists in the file
+ *                geomagnetic elements are recorded in the file
+ *        Call imcdf_list_variables () to discover the variables in the file, 
+ *                including temperature variables, with the type, element, 
+ *                number of records, time stamp variable and compression of 
+ *                each one (free the list with imcdf_free_variable_list ())
  *        Call imcdf_read_variable multiple () times, once for each field
  *                element or temperature that you wish to retrive from the file
  *              Call imcdf_read_time_stamps() to read the time stamps for the variables
+ *              (or call imcdf_read_time_stamps_compact () to hold regular time
+ *              stamps as a start and a step rather than an array, and use
+ *              imcdf_get_time_stamp () to get each time stamp)
+ *              (or call imcdf_read_variable_range () and imcdf_read_time_stamps_range ()
+ *              to read only the data inside a time range)
+ *              (or call imcdf_iter_open () and imcdf_iter_next () to step through
+ *              a variable and its time stamps a window at a time, which reads
+ *              large files in a fixed amount of memory)
+ *              (or call imcdf_read_file () to read the whole file - attributes,
+ *              every variable and their time stamps - in one call)
  *        Call imcdf_close2 ()
  *         Call imcdf_free_global_attrs () and imcdf_free_variable () and
  *                imcdf_free_time_stamps () to free memory the was allocated
  *                when reading attributes, variables and time stamps
+ *              (or use the _arena versions of the read routines, e.g.
+ *              imcdf_read_variable_arena (), to take all the memory from an
+ *              IMCDFArena and free it with a single call to imcdf_arena_free ())
+ *
+ * To read many ImagCDF files, one after another:
+ *        Call imcdf_reader_init () once to set up an IMCDFReader
+ *        For each file call imcdf_reader_open (), then the imcdf_reader_read_...
+ *                routines, then imcdf_reader_close () - the reader's memory is
+ *                reused from one file to the next
+ *        Call imcdf_reader_free () when there are no more files to read
  *
  * To write an ImagCDF file:
  *        Call imcdf_open2 ()
@@ -32,6 +57,9 @@
  *        Call imcdf_write_time_stamps () to write the time stamps
  *        Call imcdf_close2 ()
  *
+ * Routines that return an error message also record the details of the error
+ * for the calling thread - call imcdf_get_last_error () to retrieve them
+ *
  * Simon Flower, 20/12/2012
  * Updates to version 1.1 of ImagCDF. Simon Flower, 19/02/2015 
  * Updates to version 1.3 of ImagCDF. Simon Flower, 09/09/2025
@@ -39,16 +67,104 @@
 #include <string.h>
 #include <strings.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <ctype.h>
 #include <time.h>
 #include <stdio.h>
  
 #include "imcdf.h"
 
+/* private global variables: */
+/* the last error reported by this thread */
+static IMCDF_THREAD_LOCAL struct IMCDFError last_error;
+
+/* the ImagCDF global attributes - imcdf_read_global_attr_set () uses this
+ * table to sort the attributes it finds into an IMCDFGlobalAttr structure */
+enum GlobalAttrType {GA_STRING, GA_DOUBLE, GA_TT2000, GA_PUB_LEVEL, 
+                     GA_STAND_LEVEL, GA_STRING_LIST};
+struct StandardGlobalAttr
+{
+    char *name;
+    enum GlobalAttrType type;
+    int required;
+    /* the offset of the field in IMCDFGlobalAttr and, for lists, the 
+     * offset of the field that holds the number of entries */
+    size_t offset;
+    size_t count_offset;
+};
+#define GA_FIELD(f) offsetof (struct IMCDFGlobalAttr, f)
+static struct StandardGlobalAttr standard_global_attrs [] = 
+{
+    {"FormatDescription", GA_STRING,      1, GA_FIELD (format_description), 0},
+    {"FormatVersion",     GA_STRING,      1, GA_FIELD (format_version),     0},
+    {"Title",             GA_STRING,      1, GA_FIELD (title),              0},
+    {"IagaCode",          GA_STRING,      1, GA_FIELD (iaga_code),          0},
+    {"ElementsRecorded",  GA_STRING,      1, GA_FIELD (elements_recorded),  0},
+    {"PublicationLevel",  GA_PUB_LEVEL,   1, GA_FIELD (pub_level),          0},
+    {"PublicationDate",   GA_TT2000,      1, GA_FIELD (pub_date),           0},
+    {"ObservatoryName",   GA_STRING,      1, GA_FIELD (observatory_name),   0},
+    {"Latitude",          GA_DOUBLE,      1, GA_FIELD (latitude),           0},
+    {"Longitude",         GA_DOUBLE,      1, GA_FIELD (longitude),          0},
+    {"Elevation",         GA_DOUBLE,      1, GA_FIELD (elevation),          0},
+    {"Institution",       GA_STRING,      1, GA_FIELD (institution),        0},
+    {"VectorSensOrient",  GA_STRING,      0, GA_FIELD (vector_sens_orient), 0},
+    {"StandardLevel",     GA_STAND_LEVEL, 1, GA_FIELD (standard_level),     0},
+    {"StandardName",      GA_STRING,      0, GA_FIELD (standard_name),      0},
+    {"StandardVersion",   GA_STRING,      0, GA_FIELD (standard_version),   0},
+    {"PartialStandDesc",  GA_STRING,      0, GA_FIELD (partial_stand_desc), 0},
+    {"Source",            GA_STRING,      1, GA_FIELD (source),             0},
+    {"TermsOfUse",        GA_STRING,      0, GA_FIELD (terms_of_use),       0},
+    {"UniqueIdentifier",  GA_STRING,      0, GA_FIELD (unique_identifier),  0},
+    {"ParentIdentifiers", GA_STRING_LIST, 0, GA_FIELD (parent_identifiers), GA_FIELD (n_parent_identifiers)},
+    {"ReferenceLinks",    GA_STRING_LIST, 0, GA_FIELD (reference_links),    GA_FIELD (n_reference_links)}
+};
+#define N_STANDARD_GLOBAL_ATTRS ((int) (sizeof (standard_global_attrs) / sizeof (struct StandardGlobalAttr)))
+
+/* an attribute and an entry of a global attribute, as found by 
+ * imcdf_read_global_attr_set () */
+struct AttrInfo
+{
+    char name [CDF_ATTR_NAME_LEN256 +1];
+    int is_global;
+    int n_entries;
+};
+struct GlobalEntry
+{
+    int attr_num;
+    int entry_no;
+    long data_type;
+    int n_elements;
+    int n_bytes;
+    /* index into standard_global_attrs, -1 for an extra attribute */
+    int std_index;
+};
+
+/* round the size of a column read by imcdf_read_file () so that the next
+ * column is aligned */
+#define COLUMN_ROUND(n) (((n) + (IMCDF_COLUMN_ALIGN -1)) & ~((size_t) (IMCDF_COLUMN_ALIGN -1)))
+
+/* round sizes in the attribute storage block so that each item is aligned */
+#define STORAGE_ALIGN(n) (((n) + 7) & ~((size_t) 7))
+
 /* private forward declarations */
 static int is_blank (char *s);
-static char *create_var_name (enum IMCDFVariableType var_type, char *elem_rec);
-static char *format_error_message (char *msg, char *param, int cdf_status);
+static void classify_variable (struct IMCDFVariableInfo *info);
+static char *create_var_name (enum IMCDFVariableType var_type, char *elem_rec, char *var_name);
+static char *read_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_attrs,
+                               struct IMCDFArena *arena);
+static char *read_global_attr_list (int cdf_handle, char *name, struct IMCDFArena *arena,
+                                    char ***list, int *n_entries);
+static int find_standard_global_attr (char *name, int entry_no, long data_type, int n_elements);
+static char *check_global_attrs (struct IMCDFGlobalAttr *global_attrs);
+static char *format_error_message (enum IMCDFErrorCode code, char *msg, char *param, 
+                                  CDFstatus cdf_status);
+static char *read_variable_metadata (int cdf_handle, enum IMCDFVariableType var_type, 
+                                     char *elem_rec, struct IMCDFVariable *variable,
+                                     char *var_name, char *str_buffer, int str_buffer_len,
+                                     int *str_needed, struct IMCDFArena *arena);
+static int get_variable_attribute_string (int cdf_handle, char *attr_name, char *var_name,
+                                          char **value, char **str_buffer, int *str_buffer_len,
+                                          int *str_needed, struct IMCDFArena *arena);
 
 /** ------------------------------------------------------------------------
  *  ---- Open and close (using character based error return as for all -----
@@ -75,7 +191,7 @@ char *imcdf_open2 (char *filename, enum IMCDFOpenType open_type,
 
     *cdf_handle = imcdf_open (filename, open_type, compress_type);
     if (*cdf_handle < 0)
-        return format_error_message ("Error opening CDF file", filename, imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error opening CDF file", filename, imcdf_get_last_status_code ());
     return 0;
     
 }
@@ -95,7 +211,7 @@ char *imcdf_close2 (int cdf_handle)
  
 {
     if (imcdf_close (cdf_handle))
-        return format_error_message ("Error closing CDF file", 0, imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error closing CDF file", 0, imcdf_get_last_status_code ());
     return 0;
 
 }
@@ -119,247 +235,1308 @@ char *imcdf_close2 (int cdf_handle)
 char *imcdf_read_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_attrs)
 
 {
+    return read_global_attrs (cdf_handle, global_attrs, 0);
+}
 
-    int found, imcdf_version;
-    char *pl_str, *sl_str, *str, *ptr;
+/*****************************************************************************
+ * imcdf_read_global_attrs_arena
+ * imcdf_read_variable_arena
+ * imcdf_read_time_stamps_arena
+ *
+ * Description: as imcdf_read_global_attrs (), imcdf_read_variable () and
+ *              imcdf_read_time_stamps (), but all the memory is allocated
+ *              from an arena, so everything read from a file can be
+ *              released with one call to imcdf_arena_free () (or 
+ *              imcdf_arena_reset ()) - don't call the imcdf_free_... 
+ *              routines for data read this way. If there is an error some
+ *              memory may have been taken from the arena
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_type, elem_rec, var_name - as for the other routines
+ *                   arena - the arena to allocate memory from
+ * Output parameters: global_attrs, variable, ts - as for the other routines
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_global_attrs_arena (int cdf_handle, struct IMCDFGlobalAttr *global_attrs,
+                                    struct IMCDFArena *arena)
 
-    /* get the global attributes */
-    if (imcdf_get_global_attribute_string (cdf_handle, "FormatDescription",    0, &(global_attrs->format_description))) 
-      return format_error_message ("Error reading global attribute", "FormatDescription", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "FormatVersion",        0, &(global_attrs->format_version)))     
-      return format_error_message ("Error reading global attribute", "FormatVersion", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "Title",                0, &(global_attrs->title)))              
-      return format_error_message ("Error reading global attribute", "Title", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "IagaCode",             0, &(global_attrs->iaga_code)))          
-      return format_error_message ("Error reading global attribute", "IagaCode", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "ElementsRecorded",     0, &(global_attrs->elements_recorded)))  
-      return format_error_message ("Error reading global attribute", "ElementsRecorded", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "PublicationLevel",     0, &pl_str))                             
-      return format_error_message ("Error reading global attribute", "PublicationLevel", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_tt2000 (cdf_handle, "PublicationDate",      0, &(global_attrs->pub_date)))           
-      return format_error_message ("Error reading global attribute", "PublicationDate", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "ObservatoryName",      0, &(global_attrs->observatory_name)))   
-      return format_error_message ("Error reading global attribute", "ObservatoryName", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_double (cdf_handle, "Latitude",             0, &(global_attrs->latitude)))           
-      return format_error_message ("Error reading global attribute", "Latitude", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_double (cdf_handle, "Longitude",            0, &(global_attrs->longitude)))          
-      return format_error_message ("Error reading global attribute", "Longitude", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_double (cdf_handle, "Elevation",            0, &(global_attrs->elevation)))          
-      return format_error_message ("Error reading global attribute", "Elevation", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "Institution",          0, &(global_attrs->institution)))        
-      return format_error_message ("Error reading global attribute", "Institution", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "VectorSensOrient",     0, &(global_attrs->vector_sens_orient))) 
-      global_attrs->vector_sens_orient = 0;
-    if (imcdf_get_global_attribute_string (cdf_handle, "StandardLevel",        0, &sl_str))                             
-      return format_error_message ("Error reading global attribute", "StandardLevel", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "StandardName",         0, &(global_attrs->standard_name)))      
-      global_attrs->standard_name = 0;;
-    if (imcdf_get_global_attribute_string (cdf_handle, "StandardVersion",      0, &(global_attrs->standard_version)))   
-      global_attrs->standard_version = 0;
-    if (imcdf_get_global_attribute_string (cdf_handle, "PartialStandDesc",     0, &(global_attrs->partial_stand_desc))) 
-      global_attrs->partial_stand_desc = 0;;
-    if (imcdf_get_global_attribute_string (cdf_handle, "Source",               0, &(global_attrs->source)))             
-      return format_error_message ("Error reading global attribute", "Source", imcdf_get_last_status_code ());
-    if (imcdf_get_global_attribute_string (cdf_handle, "TermsOfUse",           0, &(global_attrs->terms_of_use)))       
-      global_attrs->terms_of_use = 0;
-    if (imcdf_get_global_attribute_string (cdf_handle, "UniqueIdentifier",     0, &(global_attrs->unique_identifier)))  
-      global_attrs->unique_identifier = 0;
-    global_attrs->pub_level = imcdf_parse_pub_level_string (pl_str);
-    global_attrs->standard_level = imcdf_parse_standard_level_string (sl_str);
-    free (pl_str);
-    free (sl_str);
-    global_attrs->parent_identifiers = 0;
-    global_attrs->n_parent_identifiers = 0;
-    for (found=1; found; )
+{
+    return read_global_attrs (cdf_handle, global_attrs, arena);
+}
+
+char *imcdf_read_variable_arena (int cdf_handle, enum IMCDFVariableType var_type, 
+                                 char *elem_rec, struct IMCDFVariable *variable,
+                                 struct IMCDFArena *arena)
+
+{
+    char var_name [IMCDF_VAR_NAME_LEN], *err_msg;
+    
+    err_msg = read_variable_metadata (cdf_handle, var_type, elem_rec, variable, var_name, 0, 0, 0, arena);
+    if (err_msg) return err_msg;
+    
+    variable->data = imcdf_get_var_data_arena (cdf_handle, var_name, arena, &(variable->data_len));
+    if (! variable->data) 
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading variable data", var_name, imcdf_get_last_status_code ());
+    return 0;
+}
+
+char *imcdf_read_time_stamps_arena (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts,
+                                    struct IMCDFArena *arena)
+
+{
+    ts->var_name = var_name;
+    ts->time_stamps = imcdf_get_var_time_stamps_arena (cdf_handle, var_name, arena, &(ts->data_len));
+    if (! ts->time_stamps)
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", var_name, imcdf_get_last_status_code ());
+    return 0;
+}
+
+/*****************************************************************************
+ * imcdf_read_global_attr_set
+ *
+ * Description: Read the global attributes from an ImagCDF file in one pass,
+ *              as an alternative to imcdf_read_global_attrs () - every 
+ *              global attribute in the file is enumerated once, rather than
+ *              looking up each attribute by name, and the strings and arrays
+ *              are stored together in one block of memory. Attributes (or
+ *              extra entries of attributes) that are not part of ImagCDF are
+ *              kept in the extra_attrs list
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ * Output parameters: attr_set - the attributes - free them with 
+ *                               imcdf_free_global_attr_set ()
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_global_attr_set (int cdf_handle, struct IMCDFGlobalAttrSet *attr_set)
+
+{
+    int n_attrs, n_entries, count, count2, status, length;
+    int n_found [N_STANDARD_GLOBAL_ATTRS];
+    size_t size;
+    char *ptr, *err_msg, *field;
+    struct AttrInfo *attrs;
+    struct GlobalEntry *entries, *entry;
+    struct StandardGlobalAttr *std_attr;
+    struct IMCDFExtraAttr *extra;
+
+    memset (attr_set, 0, sizeof (struct IMCDFGlobalAttrSet));
+
+    /* list the attributes */
+    if (imcdf_get_n_attributes (cdf_handle, &n_attrs))
+        return format_error_message (IMCDF_ERROR_CDF, "Error finding number of attributes", 0, imcdf_get_last_status_code ());
+    attrs = malloc (sizeof (struct AttrInfo) * (n_attrs > 0 ? n_attrs : 1));
+    if (! attrs)
+        return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", "global attributes", CDF_OK);
+    for (count=n_entries=0; count<n_attrs; count++)
     {
-          if (! imcdf_get_global_attribute_string (cdf_handle, "ParentIdentifiers", global_attrs->n_parent_identifiers, &(str)))
+        if (imcdf_get_attribute_info (cdf_handle, count, attrs [count].name, sizeof (attrs [count].name),
+                                      &(attrs [count].is_global), &(attrs [count].n_entries)))
         {
-            global_attrs->parent_identifiers = realloc (global_attrs->parent_identifiers, sizeof (char *) * (global_attrs->n_parent_identifiers +1));
-            if (! global_attrs->parent_identifiers)
-                return format_error_message ("Error allocating memory", "ParentIdentifiers", CDF_OK);
-            global_attrs->parent_identifiers [global_attrs->n_parent_identifiers ++] = str;
+            free (attrs);
+            return format_error_message (IMCDF_ERROR_CDF, "Error reading attribute description", 0, imcdf_get_last_status_code ());
         }
-        else
-            found = 0;
+        n_entries += attrs [count].n_entries;
+    }
+
+    /* describe each global entry and work out how much storage is needed */
+    entries = malloc (sizeof (struct GlobalEntry) * (n_entries > 0 ? n_entries : 1));
+    if (! entries)
+    {
+        free (attrs);
+        return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", "global attributes", CDF_OK);
+    }
+    memset (n_found, 0, sizeof (n_found));
+    size = 0;
+    for (count=n_entries=0; count<n_attrs; count++)
+    {
+        for (count2=0; count2<attrs [count].n_entries; count2++)
+        {
+            entry = entries + n_entries;
+            status = imcdf_get_global_entry_info (cdf_handle, count, count2, &(entry->data_type),
+                                                  &(entry->n_elements), &(entry->n_bytes));
+            if (status > 0) continue;
+            if (status < 0)
+            {
+                err_msg = format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", attrs [count].name, imcdf_get_last_status_code ());
+                free (entries);
+                free (attrs);
+                return err_msg;
+            }
+            entry->attr_num = count;
+            entry->entry_no = count2;
+            entry->std_index = find_standard_global_attr (attrs [count].name, count2, entry->data_type, entry->n_elements);
+            if (entry->std_index < 0)
+            {
+                attr_set->n_extra_attrs ++;
+                size += STORAGE_ALIGN (strlen (attrs [count].name) +1) + STORAGE_ALIGN (entry->n_bytes +1);
+            }
+            else
+            {
+                n_found [entry->std_index] ++;
+                if (entry->data_type == CDF_CHAR) size += STORAGE_ALIGN (entry->n_bytes +1);
+            }
+            n_entries ++;
+        }
+    }
+    size += STORAGE_ALIGN (sizeof (struct IMCDFExtraAttr) * attr_set->n_extra_attrs);
+    for (count=0; count<N_STANDARD_GLOBAL_ATTRS; count++)
+    {
+        if (standard_global_attrs [count].type == GA_STRING_LIST)
+            size += STORAGE_ALIGN (sizeof (char *) * n_found [count]);
+    }
+
+    /* carve the extra attribute list and string lists from the storage block */
+    attr_set->storage = malloc (size > 0 ? size : 1);
+    if (! attr_set->storage)
+    {
+        free (entries);
+        free (attrs);
+        return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", "global attributes", CDF_OK);
+    }
+    ptr = attr_set->storage;
+    attr_set->extra_attrs = (struct IMCDFExtraAttr *) ptr;
+    ptr += STORAGE_ALIGN (sizeof (struct IMCDFExtraAttr) * attr_set->n_extra_attrs);
+    for (count=0; count<N_STANDARD_GLOBAL_ATTRS; count++)
+    {
+        std_attr = standard_global_attrs + count;
+        if (std_attr->type != GA_STRING_LIST) continue;
+        *((char ***) ((char *) &(attr_set->global_attrs) + std_attr->offset)) = n_found [count] ? (char **) ptr : 0;
+        ptr += STORAGE_ALIGN (sizeof (char *) * n_found [count]);
     }
-    global_attrs->reference_links = 0;
-    global_attrs->n_reference_links = 0;
-    for (found=1; found; )
+
+    /* read the entries */
+    err_msg = 0;
+    extra = attr_set->extra_attrs;
+    for (count=0; count<n_entries && ! err_msg; count++)
     {
-          if (! imcdf_get_global_attribute_string (cdf_handle, "ReferenceLinks", global_attrs->n_reference_links, &(str)))
+        entry = entries + count;
+        if (entry->std_index < 0)
         {
-            global_attrs->reference_links = realloc (global_attrs->reference_links, sizeof (char *) * (global_attrs->n_reference_links +1));
-            if (! global_attrs->reference_links)
-                return format_error_message ("Error allocating memory", "ReferenceLinks", CDF_OK);
-            global_attrs->reference_links [global_attrs->n_reference_links ++] = str;
+            length = strlen (attrs [entry->attr_num].name);
+            extra->name = strcpy (ptr, attrs [entry->attr_num].name);
+            ptr += STORAGE_ALIGN (length +1);
+            extra->entry_no = entry->entry_no;
+            extra->data_type = entry->data_type;
+            extra->n_elements = entry->n_elements;
+            extra->value = ptr;
+            field = ptr;
+            ptr += STORAGE_ALIGN (entry->n_bytes +1);
+            extra ++;
         }
         else
-            found = 0;
+        {
+            std_attr = standard_global_attrs + entry->std_index;
+            field = (char *) &(attr_set->global_attrs) + std_attr->offset;
+            if (entry->data_type == CDF_CHAR)
+            {
+                if (std_attr->type == GA_STRING)
+                    *((char **) field) = ptr;
+                else if (std_attr->type == GA_STRING_LIST)
+                    (*((char ***) field)) [(*((int *) ((char *) &(attr_set->global_attrs) + std_attr->count_offset))) ++] = ptr;
+                field = ptr;
+                ptr += STORAGE_ALIGN (entry->n_bytes +1);
+            }
+        }
+        if (imcdf_get_global_entry (cdf_handle, entry->attr_num, entry->entry_no, field))
+            err_msg = format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", attrs [entry->attr_num].name, imcdf_get_last_status_code ());
+        else if (entry->data_type == CDF_CHAR)
+        {
+            *(field + entry->n_bytes) = '\0';
+            if (entry->std_index >= 0 && standard_global_attrs [entry->std_index].type == GA_PUB_LEVEL)
+                attr_set->global_attrs.pub_level = imcdf_parse_pub_level_string (field);
+            else if (entry->std_index >= 0 && standard_global_attrs [entry->std_index].type == GA_STAND_LEVEL)
+                attr_set->global_attrs.standard_level = imcdf_parse_standard_level_string (field);
+        }
     }
+    free (entries);
+    free (attrs);
 
-    /* check metadata */
-    if (strcasecmp (global_attrs->title,              "Geomagnetic time series data")) 
-        return format_error_message ("Title of data incorrect", global_attrs->title, CDF_OK);
-    if (strcasecmp (global_attrs->format_description, "INTERMAGNET CDF Format"))
-        return format_error_message ("Description of data incorrect", global_attrs->format_description, CDF_OK);
-    imcdf_version = (int) ((strtod (global_attrs->format_version, &ptr) * 10.0) + 0.5);
-    if (imcdf_version < 11 || imcdf_version > 13)
-        return format_error_message ("Format incorrect", global_attrs->format_version, CDF_OK);
+    /* check that the required attributes are present and that the metadata is valid */
+    for (count=0; count<N_STANDARD_GLOBAL_ATTRS && ! err_msg; count++)
+    {
+        if (standard_global_attrs [count].required && ! n_found [count])
+            err_msg = format_error_message (IMCDF_ERROR_INVALID_FORMAT, "Missing global attribute", standard_global_attrs [count].name, CDF_OK);
+    }
+    if (! err_msg) err_msg = check_global_attrs (&(attr_set->global_attrs));
+    if (err_msg) imcdf_free_global_attr_set (attr_set);
+    return err_msg;
+}
+
+/*****************************************************************************
+ * imcdf_list_variables
+ *
+ * Description: list the variables in an ImagCDF file, walking the file's
+ *              variables once - use this to find which variables (including
+ *              temperatures) are in a file and how large they are before 
+ *              reading them, rather than trying to read each possible 
+ *              variable in turn
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ * Output parameters: variables - an array describing each variable, in the
+ *                                order they are held in the file - free it
+ *                                with imcdf_free_variable_list ()
+ *                    n_variables - the number of variables in the array
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_list_variables (int cdf_handle, struct IMCDFVariableInfo **variables,
+                            int *n_variables)
+
+{
+    int count, n_vars;
+    struct IMCDFVariableInfo *info;
+
+    *variables = 0;
+    *n_variables = 0;
+    if (imcdf_get_n_vars (cdf_handle, &n_vars))
+        return format_error_message (IMCDF_ERROR_CDF, "Error finding number of variables", 0, imcdf_get_last_status_code ());
+    if (n_vars <= 0) return 0;
+
+    info = malloc (sizeof (struct IMCDFVariableInfo) * n_vars);
+    if (! info)
+        return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", "variable list", CDF_OK);
+    for (count=0; count<n_vars; count++)
+    {
+        if (imcdf_get_var_info (cdf_handle, count, info [count].var_name, IMCDF_VAR_NAME_LEN,
+                                &(info [count].data_type), &(info [count].n_recs),
+                                info [count].depend_0, IMCDF_VAR_NAME_LEN,
+                                &(info [count].compress_type)))
+        {
+            free (info);
+            return format_error_message (IMCDF_ERROR_CDF, "Error reading variable description", 0, imcdf_get_last_status_code ());
+        }
+        classify_variable (info + count);
+    }
+
+    *variables = info;
+    *n_variables = n_vars;
+    return 0;
+}
+
+/*****************************************************************************
+ * imcdf_read_variable
+ *
+ * Description: read a variable and its metadata from an ImagCDF file
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_type - the variable type
+ *                   elem_rec - H,D,Z... for geomagnetic data, 1,2,3.. for temperature data
+ * Output parameters: var - the variable and it's metadata
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_variable (int cdf_handle, enum IMCDFVariableType var_type, 
+                           char *elem_rec, struct IMCDFVariable *variable)
+
+{
+    char var_name [IMCDF_VAR_NAME_LEN], *err_msg;
+    
+    /* read the variable metadata */
+    err_msg = read_variable_metadata (cdf_handle, var_type, elem_rec, variable, var_name, 0, 0, 0, 0);
+    if (err_msg) return err_msg;
+    
+    /* read the data */
+    variable->data = imcdf_get_var_data (cdf_handle, var_name, &(variable->data_len));
+    if (! variable->data) 
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading variable data", var_name, imcdf_get_last_status_code ());
+        
+    return 0;
+
+}
+
+
+/*****************************************************************************
+ * imcdf_read_time_stamps
+ *
+ * Description: read a time stamp variable from an ImagCDF file
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_name - name of the variable that holds the time stamps
+ * Output parameters: ts - the time stamp data
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_time_stamps (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts)
+
+{
+
+    ts->var_name = var_name;
+    ts->time_stamps = imcdf_get_var_time_stamps (cdf_handle, var_name, &(ts->data_len));
+    if (! ts->time_stamps)
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", var_name, imcdf_get_last_status_code ());
+        
+    return 0;
+
+}
+
+/*****************************************************************************
+ * imcdf_read_time_stamps_compact
+ *
+ * Description: read a time stamp variable from an ImagCDF file - if the time
+ *              stamps have a regular cadence they are held in the compact
+ *              form (start and step) and no memory is allocated for them, 
+ *              otherwise they are read into an array as for 
+ *              imcdf_read_time_stamps (). The time stamps are checked a 
+ *              block at a time, so the check uses a fixed amount of memory -
+ *              if a block is found to be irregular, reading continues from
+ *              there into the array, so no time stamp is read twice
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_name - name of the variable that holds the time stamps
+ * Output parameters: ts - the time stamp data - time_stamps will be null if
+ *                         the compact form is used
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_time_stamps_compact (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts)
+
+{
+    int n_recs, first_rec, n_block, count, is_regular;
+    long long *buffer;
+
+    ts->var_name = var_name;
+    ts->time_stamps = 0;
+    ts->start = ts->step = 0;
+    if (imcdf_get_var_time_stamps_into (cdf_handle, var_name, 0, 0, &n_recs) < 0)
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", var_name, imcdf_get_last_status_code ());
+    ts->data_len = n_recs;
+    if (n_recs <= 0) return 0;
+
+    n_block = n_recs < IMCDF_DEFAULT_READ_CHUNK_SIZE ? n_recs : IMCDF_DEFAULT_READ_CHUNK_SIZE;
+    buffer = malloc (sizeof (long long) * n_block);
+    if (! buffer)
+        return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", var_name, CDF_OK);
+
+    /* check that every time stamp is on the grid set by the first two */
+    is_regular = 1;
+    for (first_rec=0; first_rec<n_recs && is_regular; first_rec += n_block)
+    {
+        if (n_block > n_recs - first_rec) n_block = n_recs - first_rec;
+        if (imcdf_get_var_time_stamps_range_into (cdf_handle, var_name, first_rec, n_block, buffer))
+        {
+            free (buffer);
+            return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", var_name, imcdf_get_last_status_code ());
+        }
+        if (first_rec == 0)
+        {
+            ts->start = buffer [0];
+            ts->step = n_block > 1 ? buffer [1] - buffer [0] : 0;
+            if (n_recs > 1 && ts->step <= 0) is_regular = 0;
+        }
+        for (count=0; count<n_block && is_regular; count++)
+        {
+            if (buffer [count] != ts->start + ((long long) (first_rec + count) * ts->step))
+                is_regular = 0;
+        }
+        if (! is_regular) break;
+    }
+    if (is_regular)
+    {
+        free (buffer);
+        return 0;
+    }
+
+    /* the time stamps are irregular - the blocks before this one were on
+     * the grid, this block has been read, and only the rest of the 
+     * variable needs reading */
+    ts->time_stamps = malloc (sizeof (long long) * n_recs);
+    if (! ts->time_stamps)
+    {
+        free (buffer);
+        return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", var_name, CDF_OK);
+    }
+    for (count=0; count<first_rec; count++)
+        ts->time_stamps [count] = ts->start + ((long long) count * ts->step);
+    memcpy (ts->time_stamps + first_rec, buffer, sizeof (long long) * n_block);
+    free (buffer);
+    first_rec += n_block;
+    if (first_rec < n_recs &&
+        imcdf_get_var_time_stamps_range_into (cdf_handle, var_name, first_rec, n_recs - first_rec,
+                                              ts->time_stamps + first_rec))
+    {
+        free (ts->time_stamps);
+        ts->time_stamps = 0;
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", var_name, imcdf_get_last_status_code ());
+    }
+    ts->start = ts->step = 0;
+    return 0;
+
+}
+
+/*****************************************************************************
+ * imcdf_read_variable_range
+ *
+ * Description: read a variable and its metadata from an ImagCDF file, only
+ *              reading the data that lies within a time range - the time
+ *              range is located using the variable's DEPEND_0 time stamps
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_type - the variable type
+ *                   elem_rec - H,D,Z... for geomagnetic data, 1,2,3.. for temperature data
+ *                   start_tt2000 - the start of the time range (inclusive)
+ *                   end_tt2000 - the end of the time range (inclusive)
+ * Output parameters: var - the variable and it's metadata - data_len will
+ *                          be 0 if there is no data in the time range
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_variable_range (int cdf_handle, enum IMCDFVariableType var_type, 
+                                 char *elem_rec, long long start_tt2000, long long end_tt2000,
+                                 struct IMCDFVariable *variable)
+
+{
+    int first_rec;
+    char var_name [IMCDF_VAR_NAME_LEN], *err_msg;
+    
+    /* read the variable metadata */
+    err_msg = read_variable_metadata (cdf_handle, var_type, elem_rec, variable, var_name, 0, 0, 0, 0);
+    if (err_msg) return err_msg;
+
+    /* find the records that are in range */
+    if (imcdf_find_time_stamp_range (cdf_handle, variable->depend_0, start_tt2000, end_tt2000,
+                                     &first_rec, &(variable->data_len)))
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", variable->depend_0, imcdf_get_last_status_code ());
+    
+    /* read the data */
+    variable->data = imcdf_get_var_data_range (cdf_handle, var_name, first_rec, variable->data_len);
+    if (! variable->data) 
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading variable data", var_name, imcdf_get_last_status_code ());
+        
+    return 0;
+
+}
+
+/*****************************************************************************
+ * imcdf_read_time_stamps_range
+ *
+ * Description: read the part of a time stamp variable from an ImagCDF file
+ *              that lies within a time range
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_name - name of the variable that holds the time stamps
+ *                   start_tt2000 - the start of the time range (inclusive)
+ *                   end_tt2000 - the end of the time range (inclusive)
+ * Output parameters: ts - the time stamp data - data_len will be 0 if there
+ *                         are no time stamps in the time range
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_time_stamps_range (int cdf_handle, char *var_name, 
+                                    long long start_tt2000, long long end_tt2000,
+                                    struct IMCDFVariableTS *ts)
+
+{
+    int first_rec;
+
+    ts->var_name = var_name;
+    if (imcdf_find_time_stamp_range (cdf_handle, var_name, start_tt2000, end_tt2000,
+                                     &first_rec, &(ts->data_len)))
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", var_name, imcdf_get_last_status_code ());
+    ts->time_stamps = imcdf_get_var_time_stamps_range (cdf_handle, var_name, first_rec, ts->data_len);
+    if (! ts->time_stamps)
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", var_name, imcdf_get_last_status_code ());
+        
+    return 0;
+
+}
+
+/*****************************************************************************
+ * imcdf_read_variable_into
+ *
+ * Description: read a variable and its metadata from an ImagCDF file into
+ *              memory supplied by the caller - no memory is allocated, so 
+ *              buffers can be reused between calls. Do not call
+ *              imcdf_free_variable () on a variable read with this function
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_type - the variable type
+ *                   elem_rec - H,D,Z... for geomagnetic data, 1,2,3.. for temperature data
+ *                   str_buffer - space for the metadata strings
+ *                   str_buffer_len - the size of str_buffer
+ *                   data - space for the data
+ *                   data_capacity - the number of samples that data can hold
+ * Output parameters: var - the variable and it's metadata - the strings point
+ *                          into str_buffer and the data points to data. If
+ *                          data is too small an error is returned and 
+ *                          data_len holds the number of samples needed
+ *                    str_buffer_needed - if not null, the number of bytes of
+ *                                        str_buffer that the metadata strings
+ *                                        need - set whether or not they
+ *                                        fitted, so that a buffer that is
+ *                                        too small can be resized
+ * Returns: null for success, an error message if there was a fault - if
+ *          str_buffer or data is too small the error code (see 
+ *          imcdf_get_last_error ()) is IMCDF_ERROR_BUFFER_TOO_SMALL. The
+ *          data is not read if the metadata strings did not fit
+ *
+ *****************************************************************************/
+char *imcdf_read_variable_into (int cdf_handle, enum IMCDFVariableType var_type, 
+                                char *elem_rec, struct IMCDFVariable *variable,
+                                char *str_buffer, int str_buffer_len, int *str_buffer_needed,
+                                double *data, int data_capacity)
+
+{
+    char var_name [IMCDF_VAR_NAME_LEN], *err_msg;
     
+    /* read the variable metadata */
+    if (! str_buffer) return format_error_message (IMCDF_ERROR_INVALID_ARGUMENT, "Missing metadata buffer", 0, CDF_OK);
+    err_msg = read_variable_metadata (cdf_handle, var_type, elem_rec, variable, var_name,
+                                      str_buffer, str_buffer_len, str_buffer_needed, 0);
+    if (err_msg) return err_msg;
+    
+    /* read the data */
+    variable->data = data;
+    switch (imcdf_get_var_data_into (cdf_handle, var_name, data, data_capacity, &(variable->data_len)))
+    {
+    case 0:
+        break;
+    case 1:
+        return format_error_message (IMCDF_ERROR_BUFFER_TOO_SMALL, "Buffer too small for variable data", var_name, CDF_OK);
+    default:
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading variable data", var_name, imcdf_get_last_status_code ());
+    }
+        
     return 0;
+
+}
+
+/*****************************************************************************
+ * imcdf_read_time_stamps_into
+ *
+ * Description: read a time stamp variable from an ImagCDF file into memory
+ *              supplied by the caller - no memory is allocated. Do not call
+ *              imcdf_free_time_stamps () on time stamps read with this function
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_name - name of the variable that holds the time stamps
+ *                   time_stamps - space for the time stamps
+ *                   capacity - the number of time stamps the space can hold
+ * Output parameters: ts - the time stamp data - if time_stamps is too small
+ *                         an error is returned and data_len holds the 
+ *                         number of time stamps needed
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_time_stamps_into (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts,
+                                   long long *time_stamps, int capacity)
+
+{
+
+    ts->var_name = var_name;
+    ts->time_stamps = time_stamps;
+    switch (imcdf_get_var_time_stamps_into (cdf_handle, var_name, time_stamps, capacity, &(ts->data_len)))
+    {
+    case 0:
+        break;
+    case 1:
+        return format_error_message (IMCDF_ERROR_BUFFER_TOO_SMALL, "Buffer too small for time stamps", var_name, CDF_OK);
+    default:
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", var_name, imcdf_get_last_status_code ());
+    }
+        
+    return 0;
+
+}
+
+/*****************************************************************************
+ * imcdf_iter_open
+ *
+ * Description: prepare to read a variable and its DEPEND_0 time stamps a 
+ *              window of records at a time - the data is not read until
+ *              imcdf_iter_next () is called. Memory for one window is 
+ *              allocated here and reused for each window, so files of any
+ *              size can be read in a fixed amount of memory
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_type - the variable type
+ *                   elem_rec - H,D,Z... for geomagnetic data, 1,2,3.. for temperature data
+ *                   window_size - the number of records in each window, 0 to
+ *                                 use IMCDF_DEFAULT_READ_CHUNK_SIZE
+ * Output parameters: iter - the iterator - the variable's metadata is 
+ *                           available in iter->variable
+ * Returns: null for success, an error message if there was a fault - 
+ *          imcdf_iter_close () must be called after a successful return
+ *
+ *****************************************************************************/
+char *imcdf_iter_open (int cdf_handle, enum IMCDFVariableType var_type, 
+                       char *elem_rec, int window_size,
+                       struct IMCDFRecordIterator *iter)
+
+{
+    int n_data, n_ts;
+    char *err_msg;
+
+    if (window_size < 0) return format_error_message (IMCDF_ERROR_INVALID_ARGUMENT, "Invalid iterator window size", 0, CDF_OK);
+    if (window_size == 0) window_size = IMCDF_DEFAULT_READ_CHUNK_SIZE;
+
+    /* read the variable metadata */
+    err_msg = read_variable_metadata (cdf_handle, var_type, elem_rec, &(iter->variable), 
+                                      iter->var_name, 0, 0, 0, 0);
+    if (err_msg) return err_msg;
+
+    /* find the number of records - where the data and time stamps differ 
+     * in length only the records that have both are returned */
+    if (imcdf_get_var_data_into (cdf_handle, iter->var_name, 0, 0, &n_data) < 0)
+        err_msg = format_error_message (IMCDF_ERROR_CDF, "Error reading variable data", iter->var_name, imcdf_get_last_status_code ());
+    else if (imcdf_get_var_time_stamps_into (cdf_handle, iter->variable.depend_0, 0, 0, &n_ts) < 0)
+        err_msg = format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", iter->variable.depend_0, imcdf_get_last_status_code ());
+    if (err_msg)
+    {
+        free (iter->variable.field_nam);
+        free (iter->variable.units);
+        free (iter->variable.depend_0);
+        return err_msg;
+    }
+    iter->n_recs = n_data < n_ts ? n_data : n_ts;
+    if (window_size > iter->n_recs) window_size = iter->n_recs > 0 ? iter->n_recs : 1;
+
+    /* allocate the window */
+    iter->variable.data = malloc (sizeof (double) * window_size);
+    iter->ts.time_stamps = malloc (sizeof (long long) * window_size);
+    if (! iter->variable.data || ! iter->ts.time_stamps)
+    {
+        if (iter->variable.data) free (iter->variable.data);
+        if (iter->ts.time_stamps) free (iter->ts.time_stamps);
+        free (iter->variable.field_nam);
+        free (iter->variable.units);
+        free (iter->variable.depend_0);
+        return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", "iterator", CDF_OK);
+    }
+
+    iter->cdf_handle = cdf_handle;
+    iter->ts.var_name = iter->variable.depend_0;
+    iter->variable.data_len = iter->ts.data_len = 0;
+    iter->first_rec = 0;
+    iter->window_size = window_size;
+    return 0;
+
+}
+
+/*****************************************************************************
+ * imcdf_iter_open_range
+ *
+ * Description: as imcdf_iter_open (), but only step through the records
+ *              whose time stamps lie inside a time range
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_type - the variable type
+ *                   elem_rec - H,D,Z... for geomagnetic data, 1,2,3.. for temperature data
+ *                   window_size - the number of records in each window, 0 to
+ *                                 use IMCDF_DEFAULT_READ_CHUNK_SIZE
+ *                   start_tt2000 - the start of the range (inclusive)
+ *                   end_tt2000 - the end of the range (inclusive)
+ * Output parameters: iter - the iterator
+ * Returns: null for success, an error message if there was a fault - 
+ *          imcdf_iter_close () must be called after a successful return
+ *
+ *****************************************************************************/
+char *imcdf_iter_open_range (int cdf_handle, enum IMCDFVariableType var_type, 
+                             char *elem_rec, int window_size,
+                             long long start_tt2000, long long end_tt2000,
+                             struct IMCDFRecordIterator *iter)
+
+{
+    int first_rec, n_recs;
+    char *err_msg;
+
+    err_msg = imcdf_iter_open (cdf_handle, var_type, elem_rec, window_size, iter);
+    if (err_msg) return err_msg;
+
+    if (imcdf_find_time_stamp_range (cdf_handle, iter->ts.var_name, start_tt2000, end_tt2000,
+                                     &first_rec, &n_recs))
+    {
+        err_msg = format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", iter->ts.var_name, imcdf_get_last_status_code ());
+        imcdf_iter_close (iter);
+        return err_msg;
+    }
+    if (first_rec + n_recs < iter->n_recs) iter->n_recs = first_rec + n_recs;
+    iter->first_rec = first_rec;
+    return 0;
+
+}
+
+
+/*****************************************************************************
+ * imcdf_iter_next
+ *
+ * Description: read the next window of records from an iterator
+ *
+ * Input parameters: iter - the iterator
+ * Output parameters: iter - iter->variable.data and iter->ts.time_stamps 
+ *                           hold the window, iter->variable.data_len and
+ *                           iter->ts.data_len the number of records in it,
+ *                           which will be 0 when all records have been read.
+ *                           iter->first_rec is the record number of the
+ *                           first record in the window
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_iter_next (struct IMCDFRecordIterator *iter)
+
+{
+    int n_recs;
+
+    /* move past the previous window */
+    iter->first_rec += iter->variable.data_len;
+    n_recs = iter->n_recs - iter->first_rec;
+    if (n_recs > iter->window_size) n_recs = iter->window_size;
+    if (n_recs < 0) n_recs = 0;
+    iter->variable.data_len = iter->ts.data_len = 0;
+    if (n_recs == 0) return 0;
+
+    if (imcdf_get_var_data_range_into (iter->cdf_handle, iter->var_name, iter->first_rec,
+                                       n_recs, iter->variable.data))
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading variable data", iter->var_name, imcdf_get_last_status_code ());
+    if (imcdf_get_var_time_stamps_range_into (iter->cdf_handle, iter->ts.var_name, iter->first_rec,
+                                              n_recs, iter->ts.time_stamps))
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", iter->ts.var_name, imcdf_get_last_status_code ());
+
+    iter->variable.data_len = iter->ts.data_len = n_recs;
+    return 0;
+
+}
+
+/*****************************************************************************
+ * imcdf_iter_close
+ *
+ * Description: Free the memory allocated after a successful call to 
+ *                imcdf_iter_open ()
+ *
+ * Input parameters: iter - the iterator
+ * Output parameters: 
+ * Returns: 
+ *
+ *****************************************************************************/
+void imcdf_iter_close (struct IMCDFRecordIterator *iter)
+
+{
+    imcdf_free_variable (&(iter->variable));
+    free (iter->ts.time_stamps);
+}
+
+    
+/*****************************************************************************
+ * imcdf_read_file
+ *
+ * Description: read a whole ImagCDF file - the global attributes, every 
+ *              data variable and the time stamps that they use. The reads
+ *              are planned from a single listing of the file's variables:
+ *              each distinct time stamp variable is read once, and all the
+ *              data and time stamps are read into one block of memory, as
+ *              columns aligned to IMCDF_COLUMN_ALIGN bytes. This replaces
+ *              calling imcdf_read_global_attrs (), imcdf_read_variable ()
+ *              and imcdf_read_time_stamps () for each variable
+ *
+ * Input parameters: filename - the CDF file to read
+ * Output parameters: file - the contents of the file - free it with 
+ *                           imcdf_free_file ()
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_file (char *filename, struct IMCDFFile *file)
+
+{
+    int cdf_handle, n_vars, count, count2;
+    size_t size, offset;
+    char *err_msg, *columns, var_name [IMCDF_VAR_NAME_LEN], elem_rec [10];
+    struct IMCDFVariableInfo *vars;
+    struct IMCDFColumn *column;
+    struct IMCDFTimeAxis *time_axis;
+
+    memset (file, 0, sizeof (struct IMCDFFile));
+    imcdf_arena_init (&(file->arena), 0);
+    err_msg = imcdf_open2 (filename, IMCDF_OPEN, IMCDF_COMPRESS_NONE, &cdf_handle);
+    if (err_msg) return err_msg;
+
+    /* plan the reads - find the data variables and the time stamps they use */
+    vars = 0;
+    n_vars = 0;
+    err_msg = imcdf_read_global_attrs_arena (cdf_handle, &(file->global_attrs), &(file->arena));
+    if (! err_msg) err_msg = imcdf_list_variables (cdf_handle, &vars, &n_vars);
+    if (! err_msg)
+    {
+        file->columns = imcdf_arena_alloc (&(file->arena), sizeof (struct IMCDFColumn) * (n_vars > 0 ? n_vars : 1));
+        file->time_axes = imcdf_arena_alloc (&(file->arena), sizeof (struct IMCDFTimeAxis) * (n_vars > 0 ? n_vars : 1));
+        if (! file->columns || ! file->time_axes)
+            err_msg = format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", filename, CDF_OK);
+    }
+    for (count=0, size=0; count<n_vars && ! err_msg; count++)
+    {
+        if (vars [count].var_type == IMCDF_VARTYPE_ERROR) continue;
+        column = file->columns + file->n_columns ++;
+        column->variable.var_type = vars [count].var_type;
+        column->variable.data_len = vars [count].n_recs;
+        column->compress_type = vars [count].compress_type;
+        strcpy (column->variable.elem_rec, vars [count].elem_rec);
+        size += COLUMN_ROUND (sizeof (double) * vars [count].n_recs);
+
+        /* find or add the column's time axis */
+        for (count2=0, column->time_axis=0; count2<file->n_time_axes && ! column->time_axis; count2++)
+        {
+            if (! strcmp (file->time_axes [count2].var_name, vars [count].depend_0))
+                column->time_axis = file->time_axes + count2;
+        }
+        for (count2=0; count2<n_vars && ! column->time_axis; count2++)
+        {
+            if (vars [count2].is_time_stamps && ! strcmp (vars [count2].var_name, vars [count].depend_0))
+            {
+                column->time_axis = file->time_axes + file->n_time_axes ++;
+                strcpy (column->time_axis->var_name, vars [count2].var_name);
+                column->time_axis->n_recs = vars [count2].n_recs;
+                size += COLUMN_ROUND (sizeof (long long) * vars [count2].n_recs);
+            }
+        }
+        if (! column->time_axis)
+            err_msg = format_error_message (IMCDF_ERROR_INVALID_FORMAT, "Time stamp variable not found", vars [count].depend_0, CDF_OK);
+    }
+    imcdf_free_variable_list (vars);
+
+    /* allocate the columns in one block - the extra space allows the start 
+     * of the block to be aligned */
+    if (! err_msg)
+    {
+        file->column_storage = malloc (size + IMCDF_COLUMN_ALIGN);
+        if (! file->column_storage)
+            err_msg = format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", filename, CDF_OK);
+    }
+    if (! err_msg)
+    {
+        columns = (char *) file->column_storage;
+        columns += (IMCDF_COLUMN_ALIGN - ((size_t) columns % IMCDF_COLUMN_ALIGN)) % IMCDF_COLUMN_ALIGN;
+        offset = 0;
+        for (count=0; count<file->n_time_axes && ! err_msg; count++)
+        {
+            time_axis = file->time_axes + count;
+            time_axis->time_stamps = (long long *) (columns + offset);
+            offset += COLUMN_ROUND (sizeof (long long) * time_axis->n_recs);
+            if (imcdf_get_var_time_stamps_range_into (cdf_handle, time_axis->var_name, 0, 
+                                                      time_axis->n_recs, time_axis->time_stamps))
+                err_msg = format_error_message (IMCDF_ERROR_CDF, "Error reading time stamps", time_axis->var_name, imcdf_get_last_status_code ());
+        }
+        for (count=0; count<file->n_columns && ! err_msg; count++)
+        {
+            column = file->columns + count;
+            strcpy (elem_rec, column->variable.elem_rec);
+            err_msg = read_variable_metadata (cdf_handle, column->variable.var_type, elem_rec,
+                                              &(column->variable), var_name, 0, 0, 0, &(file->arena));
+            if (err_msg) break;
+            column->variable.data = (double *) (columns + offset);
+            offset += COLUMN_ROUND (sizeof (double) * column->variable.data_len);
+            if (imcdf_get_var_data_range_into (cdf_handle, var_name, 0, column->variable.data_len,
+                                               column->variable.data))
+                err_msg = format_error_message (IMCDF_ERROR_CDF, "Error reading variable data", var_name, imcdf_get_last_status_code ());
+        }
+    }
+
+    if (err_msg)
+    {
+        imcdf_close2 (cdf_handle);
+        imcdf_free_file (file);
+        return err_msg;
+    }
+    err_msg = imcdf_close2 (cdf_handle);
+    if (err_msg) imcdf_free_file (file);
+    return err_msg;
+}
+
+/*****************************************************************************
+ * imcdf_free_global_attrs
+ *
+ * Description: Free the memory allocated after a successful call to 
+ *                imcdf_read_global_attrs ()
+ *
+ * Input parameters: global_attrs - the global attributes structure passed to
+ *                                    imcdf_read_global_attrs ()
+ * Output parameters: 
+ * Returns: 
+ *
+ *****************************************************************************/
+void imcdf_free_global_attrs (struct IMCDFGlobalAttr *global_attrs)
+{
+    int count;
+    
+    free (global_attrs->format_description);
+    free (global_attrs->format_version);
+    free (global_attrs->title);
+    free (global_attrs->iaga_code);
+    free (global_attrs->elements_recorded);
+    free (global_attrs->observatory_name);
+    free (global_attrs->institution);
+    if (global_attrs->vector_sens_orient) free (global_attrs->vector_sens_orient);
+    if (global_attrs->standard_name) free (global_attrs->standard_name);
+    if (global_attrs->standard_version) free (global_attrs->standard_version);
+    if (global_attrs->partial_stand_desc) free (global_attrs->partial_stand_desc);
+    free (global_attrs->source);    
+    if (global_attrs->terms_of_use) free (global_attrs->terms_of_use);
+    if (global_attrs->unique_identifier) free (global_attrs->unique_identifier);
+    for (count=0; count<global_attrs->n_parent_identifiers; count++)
+        free (global_attrs->parent_identifiers [count]);
+    if (global_attrs->parent_identifiers) free (global_attrs->parent_identifiers);
+    for (count=0; count<global_attrs->n_reference_links; count++)
+        free (global_attrs->reference_links [count]);
+    if (global_attrs->reference_links) free (global_attrs->reference_links);
+}
+
+/*****************************************************************************
+ * imcdf_free_global_attr_set
+ *
+ * Description: Free the memory allocated after a successful call to 
+ *                imcdf_read_global_attr_set ()
+ *
+ * Input parameters: attr_set - the structure passed to 
+ *                              imcdf_read_global_attr_set ()
+ * Output parameters: 
+ * Returns: 
+ *
+ *****************************************************************************/
+void imcdf_free_global_attr_set (struct IMCDFGlobalAttrSet *attr_set)
+
+{
+    free (attr_set->storage);
+    memset (attr_set, 0, sizeof (struct IMCDFGlobalAttrSet));
+}
+
+/*****************************************************************************
+ * imcdf_free_file
+ *
+ * Description: Free the memory allocated by imcdf_read_file ()
+ *
+ * Input parameters: file - the structure passed to imcdf_read_file ()
+ * Output parameters: 
+ * Returns: 
+ *
+ *****************************************************************************/
+void imcdf_free_file (struct IMCDFFile *file)
+
+{
+    free (file->column_storage);
+    imcdf_arena_free (&(file->arena));
+    memset (file, 0, sizeof (struct IMCDFFile));
+}
+
+/*****************************************************************************
+ * imcdf_free_variable
+ *
+ * Description: Free the memory allocated after a successful call to 
+ *                imcdf_read_variable ()
+ *
+ * Input parameters: variable - the variable structure passed to
+ *                                imcdf_read_variable ()
+ * Output parameters: 
+ * Returns: 
+ *
+ *****************************************************************************/
+void imcdf_free_variable (struct IMCDFVariable *variable)
+
+{
+    free (variable->field_nam);
+    free (variable->units);
+    free (variable->depend_0);
+    free (variable->data);
+}
+
+/*****************************************************************************
+ * imcdf_free_time_stamps
+ *
+ * Description: Free the memory allocated after a successful call to 
+ *                imcdf_read_time_stamps ()
+ *
+ * Input parameters: ts - the time stamp structure passed to
+ *                                    imcdf_read_time_stamps ()
+ * Output parameters: 
+ * Returns: 
+ *
+ *****************************************************************************/
+void imcdf_free_time_stamps (struct IMCDFVariableTS *ts)
+
+{
+    free (ts->time_stamps);
+}
+
+/*****************************************************************************
+ * imcdf_free_variable_list
+ *
+ * Description: Free the memory allocated after a successful call to 
+ *                imcdf_list_variables ()
+ *
+ * Input parameters: variables - the array returned by imcdf_list_variables ()
+ * Output parameters: 
+ * Returns: 
+ *
+ *****************************************************************************/
+void imcdf_free_variable_list (struct IMCDFVariableInfo *variables)
+
+{
+    free (variables);
+}
+
+/*****************************************************************************
+ * imcdf_get_time_stamp
+ *
+ * Description: get a time stamp, which may be held as an array or in the
+ *              compact form
+ *
+ * Input parameters: ts - the time stamps
+ *                   index - the index of the time stamp (from 0)
+ * Output parameters: 
+ * Returns: the time stamp - the index is not checked
+ *
+ *****************************************************************************/
+long long imcdf_get_time_stamp (struct IMCDFVariableTS *ts, int index)
+
+{
+    if (ts->time_stamps) return *(ts->time_stamps + index);
+    return ts->start + ((long long) index * ts->step);
+}
+
+/*****************************************************************************
+ * imcdf_find_time_stamp_index
+ *
+ * Description: find the first time stamp at or after a given time - the 
+ *              time stamps must be in ascending order
+ *
+ * Input parameters: ts - the time stamps
+ *                   tt2000 - the time to look for
+ * Output parameters: 
+ * Returns: the index of the time stamp - data_len if all the time stamps 
+ *          are before the time
+ *
+ *****************************************************************************/
+int imcdf_find_time_stamp_index (struct IMCDFVariableTS *ts, long long tt2000)
+
+{
+    int low, high, mid;
+    long long offset;
+
+    if (ts->data_len <= 0) return 0;
+
+    /* the compact form can be calculated directly */
+    if (! ts->time_stamps)
+    {
+        if (tt2000 <= ts->start || ts->step <= 0) return tt2000 <= ts->start ? 0 : ts->data_len;
+        /* times after the last sample are dealt with first, so that the
+         * subtraction can't overflow for times such as IMCDF_TT2000_LATEST */
+        if (tt2000 > ts->start + ((long long) (ts->data_len -1) * ts->step)) return ts->data_len;
+        offset = ((tt2000 - ts->start -1) / ts->step) +1;
+        return (int) offset;
+    }
+
+    /* search the array */
+    low = 0;
+    high = ts->data_len;
+    while (low < high)
+    {
+        mid = low + ((high - low) / 2);
+        if (*(ts->time_stamps + mid) < tt2000) low = mid +1;
+        else high = mid;
+    }
+    return low;
 }
 
 /*****************************************************************************
- * imcdf_read_variable
+ * imcdf_expand_time_stamps
  *
- * Description: read a variable and its metadata from an ImagCDF file
+ * Description: convert time stamps held in the compact form to an array - 
+ *              time stamps that are already in an array are not changed
  *
- * Input parameters: cdf_handle - handle to the CDF file
- *                   var_type - the variable type
- *                   elem_rec - H,D,Z... for geomagnetic data, 1,2,3.. for temperature data
- * Output parameters: var - the variable and it's metadata
- * Returns: null for success, an error message if there was a fault
+ * Input parameters: ts - the time stamps
+ * Output parameters: ts - the time stamps as an array - free this with 
+ *                         imcdf_free_time_stamps ()
+ * Returns: the array of time stamps, or null if memory could not be allocated
  *
  *****************************************************************************/
-char *imcdf_read_variable (int cdf_handle, enum IMCDFVariableType var_type, 
-                           char *elem_rec, struct IMCDFVariable *variable)
+long long *imcdf_expand_time_stamps (struct IMCDFVariableTS *ts)
 
 {
-    char var_name [30], *ptr;
-    
-    /* create the variable name */
-    ptr = create_var_name (var_type, elem_rec);
-    if (! ptr) return "Error: Invalid variable type";
-    strcpy (var_name, ptr);
-    
-    /* read the variable metadata */
-    variable->var_type = var_type;
-    strcpy (variable->elem_rec, elem_rec);
-    if (imcdf_get_variable_attribute_string (cdf_handle, "FIELDNAM",  var_name, &(variable->field_nam)))
-        return format_error_message ("Error reading variable attribute", "FIELDNAM", imcdf_get_last_status_code ());
-    if (imcdf_get_variable_attribute_string (cdf_handle, "UNITS",     var_name, &(variable->units)))
-        return format_error_message ("Error reading variable attribute", "UNITS", imcdf_get_last_status_code ());
-    if (imcdf_get_variable_attribute_double (cdf_handle, "FILLVAL",   var_name, &(variable->fill_val)))
-        return format_error_message ("Error reading variable attribute", "FILLVAL", imcdf_get_last_status_code ());
-    if (imcdf_get_variable_attribute_double (cdf_handle, "VALIDMIN",  var_name, &(variable->valid_min)))
-        return format_error_message ("Error reading variable attribute", "VALIDMIN", imcdf_get_last_status_code ());
-    if (imcdf_get_variable_attribute_double (cdf_handle, "VALIDMAX",  var_name, &(variable->valid_max)))
-        return format_error_message ("Error reading variable attribute", "VALIDMAX", imcdf_get_last_status_code ());
-    if (imcdf_get_variable_attribute_string (cdf_handle, "DEPEND_0",  var_name, &(variable->depend_0)))
-        return format_error_message ("Error reading variable attribute", "DEPEND_0", imcdf_get_last_status_code ());
-    
-    /* read the data */
-    variable->data = imcdf_get_var_data (cdf_handle, var_name, &(variable->data_len));
-    if (! variable->data) 
-      return format_error_message ("Error reading variable data", var_name, imcdf_get_last_status_code ());
-        
-    return 0;
+    int count;
+    long long *time_stamps;
 
+    if (ts->time_stamps) return ts->time_stamps;
+    time_stamps = malloc (sizeof (long long) * (ts->data_len > 0 ? ts->data_len : 1));
+    if (! time_stamps) return 0;
+    for (count=0; count<ts->data_len; count++)
+        *(time_stamps + count) = ts->start + ((long long) count * ts->step);
+    ts->time_stamps = time_stamps;
+    return time_stamps;
 }
 
+/** ------------------------------------------------------------------------
+ *  ------------------ Reading many files with a reader --------------------
+ *  ------------------------------------------------------------------------*/
 
 /*****************************************************************************
- * imcdf_read_time_stamps
+ * imcdf_reader_init
  *
- * Description: read a time stamp variable from an ImagCDF file
+ * Description: set up a reader - no memory is allocated until a file is read
  *
- * Input parameters: cdf_handle - handle to the CDF file
- *                   var_name - name of the variable that holds the time stamps
- * Output parameters: ts - the time stamp data
+ * Input parameters: reader - the reader
+ *                   arena_block_size - the size of the blocks of memory in
+ *                                      the reader's arena, 0 for the default
+ *                   read_chunk_size - the read chunk size to use for each 
+ *                                     file (see imcdf_set_read_chunk_size),
+ *                                     0 for the default
+ * Output parameters: none
+ * Returns: none
+ *
+ *****************************************************************************/
+void imcdf_reader_init (struct IMCDFReader *reader, size_t arena_block_size,
+                        int read_chunk_size)
+
+{
+    reader->cdf_handle = -1;
+    reader->read_chunk_size = read_chunk_size;
+    imcdf_arena_init (&(reader->arena), arena_block_size);
+    reader->n_time_axes = 0;
+}
+
+/*****************************************************************************
+ * imcdf_reader_open
+ *
+ * Description: open an ImagCDF file for reading with a reader - anything
+ *              read from the previous file is released (any file that is 
+ *              still open is closed first)
+ *
+ * Input parameters: reader - the reader
+ *                   filename - the CDF file to open
+ * Output parameters: none
  * Returns: null for success, an error message if there was a fault
  *
  *****************************************************************************/
-char *imcdf_read_time_stamps (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts)
+char *imcdf_reader_open (struct IMCDFReader *reader, char *filename)
 
 {
+    char *err_msg;
 
-    ts->var_name = var_name;
-    ts->time_stamps = imcdf_get_var_time_stamps (cdf_handle, var_name, &(ts->data_len));
-    if (! ts->time_stamps)
-        return format_error_message ("Error reading time stamps", var_name, imcdf_get_last_status_code ());
-        
-    return 0;
+    if (reader->cdf_handle >= 0)
+    {
+        err_msg = imcdf_reader_close (reader);
+        if (err_msg) return err_msg;
+    }
+    imcdf_arena_reset (&(reader->arena));
+    reader->n_time_axes = 0;
 
+    err_msg = imcdf_open2 (filename, IMCDF_OPEN, IMCDF_COMPRESS_NONE, &(reader->cdf_handle));
+    if (err_msg)
+    {
+        reader->cdf_handle = -1;
+        return err_msg;
+    }
+    if (reader->read_chunk_size > 0)
+        imcdf_set_read_chunk_size (reader->cdf_handle, reader->read_chunk_size);
+    return 0;
 }
 
-    
 /*****************************************************************************
- * imcdf_free_global_attrs
+ * imcdf_reader_read_global_attrs
+ * imcdf_reader_read_variable
+ * imcdf_reader_read_time_stamps
  *
- * Description: Free the memory allocated after a successful call to 
- *                imcdf_read_global_attrs ()
+ * Description: as imcdf_read_global_attrs (), imcdf_read_variable () and
+ *              imcdf_read_time_stamps (), but reading from the reader's 
+ *              current file into the reader's memory - don't free what is
+ *              read, it stays valid until the next file is opened or the
+ *              reader is freed. Each time stamp variable is only read once
+ *              from a file - later requests share the same time stamps
  *
- * Input parameters: global_attrs - the global attributes structure passed to
- *                                    imcdf_read_global_attrs ()
- * Output parameters: 
- * Returns: 
+ * Input parameters: reader - the reader
+ *                   var_type, elem_rec, var_name - as for the other routines
+ * Output parameters: global_attrs, variable, ts - as for the other routines
+ * Returns: null for success, an error message if there was a fault
  *
  *****************************************************************************/
-void imcdf_free_global_attrs (struct IMCDFGlobalAttr *global_attrs)
+char *imcdf_reader_read_global_attrs (struct IMCDFReader *reader, 
+                                      struct IMCDFGlobalAttr *global_attrs)
+
+{
+    if (reader->cdf_handle < 0)
+        return format_error_message (IMCDF_ERROR_INVALID_ARGUMENT, "No file open in reader", 0, CDF_OK);
+    return imcdf_read_global_attrs_arena (reader->cdf_handle, global_attrs, &(reader->arena));
+}
+
+char *imcdf_reader_read_variable (struct IMCDFReader *reader, enum IMCDFVariableType var_type, 
+                                  char *elem_rec, struct IMCDFVariable *variable)
+
+{
+    if (reader->cdf_handle < 0)
+        return format_error_message (IMCDF_ERROR_INVALID_ARGUMENT, "No file open in reader", 0, CDF_OK);
+    return imcdf_read_variable_arena (reader->cdf_handle, var_type, elem_rec, variable, &(reader->arena));
+}
+
+char *imcdf_reader_read_time_stamps (struct IMCDFReader *reader, char *var_name, 
+                                     struct IMCDFVariableTS *ts)
+
 {
     int count;
-    
-    free (global_attrs->format_description);
-    free (global_attrs->format_version);
-    free (global_attrs->title);
-    free (global_attrs->iaga_code);
-    free (global_attrs->elements_recorded);
-    free (global_attrs->observatory_name);
-    free (global_attrs->institution);
-    if (global_attrs->vector_sens_orient) free (global_attrs->vector_sens_orient);
-    if (global_attrs->standard_name) free (global_attrs->standard_name);
-    if (global_attrs->standard_version) free (global_attrs->standard_version);
-    if (global_attrs->partial_stand_desc) free (global_attrs->partial_stand_desc);
-    free (global_attrs->source);    
-    if (global_attrs->terms_of_use) free (global_attrs->terms_of_use);
-    if (global_attrs->unique_identifier) free (global_attrs->unique_identifier);
-    for (count=0; count<global_attrs->n_parent_identifiers; count++)
-        free (global_attrs->parent_identifiers + count);
-    if (global_attrs->parent_identifiers) free (global_attrs->parent_identifiers);
-    for (count=0; count<global_attrs->n_reference_links; count++)
-        free (global_attrs->reference_links + count);
-    if (global_attrs->reference_links) free (global_attrs->reference_links);
+    char *err_msg;
+
+    if (reader->cdf_handle < 0)
+        return format_error_message (IMCDF_ERROR_INVALID_ARGUMENT, "No file open in reader", 0, CDF_OK);
+
+    for (count=0; count<reader->n_time_axes; count++)
+    {
+        if (! strcmp (reader->time_axis_names [count], var_name))
+        {
+            *ts = reader->time_axes [count];
+            return 0;
+        }
+    }
+
+    err_msg = imcdf_read_time_stamps_arena (reader->cdf_handle, var_name, ts, &(reader->arena));
+    if (err_msg) return err_msg;
+    if (reader->n_time_axes < IMCDF_READER_MAX_TIME_AXES && strlen (var_name) < IMCDF_VAR_NAME_LEN)
+    {
+        count = reader->n_time_axes ++;
+        strcpy (reader->time_axis_names [count], var_name);
+        ts->var_name = reader->time_axis_names [count];
+        reader->time_axes [count] = *ts;
+    }
+    return 0;
 }
 
 /*****************************************************************************
- * imcdf_free_variable
+ * imcdf_reader_close
  *
- * Description: Free the memory allocated after a successful call to 
- *                imcdf_read_variable ()
+ * Description: close the reader's current file - what was read from the 
+ *              file stays valid until the next file is opened
  *
- * Input parameters: variable - the variable structure passed to
- *                                imcdf_read_variable ()
- * Output parameters: 
- * Returns: 
+ * Input parameters: reader - the reader
+ * Output parameters: none
+ * Returns: null for success, an error message if there was a fault
  *
  *****************************************************************************/
-void imcdf_free_variable (struct IMCDFVariable *variable)
+char *imcdf_reader_close (struct IMCDFReader *reader)
 
 {
-    free (variable->field_nam);
-    free (variable->units);
-    free (variable->depend_0);
-    free (variable->data);
+    char *err_msg;
+
+    if (reader->cdf_handle < 0) return 0;
+    err_msg = imcdf_close2 (reader->cdf_handle);
+    reader->cdf_handle = -1;
+    return err_msg;
 }
 
 /*****************************************************************************
- * imcdf_free_time_stamps
+ * imcdf_reader_free
  *
- * Description: Free the memory allocated after a successful call to 
- *                imcdf_read_time_stamps ()
+ * Description: close any file that the reader has open and free the 
+ *              reader's memory
  *
- * Input parameters: ts - the time stamp structure passed to
- *                                    imcdf_read_time_stamps ()
- * Output parameters: 
- * Returns: 
+ * Input parameters: reader - the reader
+ * Output parameters: none
+ * Returns: none
  *
  *****************************************************************************/
-void imcdf_free_time_stamps (struct IMCDFVariableTS *ts)
+void imcdf_reader_free (struct IMCDFReader *reader)
 
 {
-    free (ts->time_stamps);
+    imcdf_reader_close (reader);
+    imcdf_arena_free (&(reader->arena));
+    reader->n_time_axes = 0;
 }
 
+
 /** ------------------------------------------------------------------------
  *  ------------------------ Writing to CDF files --------------------------
  *  ------------------------------------------------------------------------*/
@@ -390,54 +1567,54 @@ char *imcdf_write_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_a
          
     /* write metadata */
     if (imcdf_add_global_attr_string (cdf_handle, "FormatDescription", 0,                                  global_attrs->format_description))
-        return format_error_message ("Error writing global attribute", "FormatDescription", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "FormatDescription", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "FormatVersion", 0,                                      global_attrs->format_version))
-        return format_error_message ("Error writing global attribute", "FormatVersion", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "FormatVersion", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "Title", 0,                                              global_attrs->title))
-        return format_error_message ("Error writing global attribute", "Title", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "Title", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "IagaCode", 0,                                           global_attrs->iaga_code))
-        return format_error_message ("Error writing global attribute", "IagaCode", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "IagaCode", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "ElementsRecorded", 0,                                   global_attrs->elements_recorded))
-        return format_error_message ("Error writing global attribute", "ElementsRecorded", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "ElementsRecorded", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "PublicationLevel", 0,    imcdf_pub_level_code_tostring (global_attrs->pub_level)))
-        return format_error_message ("Error writing global attribute", "PublicationLevel", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "PublicationLevel", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_tt2000 (cdf_handle, "PublicationDate", 0,                                    global_attrs->pub_date))
-        return format_error_message ("Error writing global attribute", "PublicationDate", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "PublicationDate", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "ObservatoryName", 0,                                    global_attrs->observatory_name))
-        return format_error_message ("Error writing global attribute", "ObservatoryName", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "ObservatoryName", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_double (cdf_handle, "Latitude", 0,                                           global_attrs->latitude))
-        return format_error_message ("Error writing global attribute", "Latitude", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "Latitude", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_double (cdf_handle, "Longitude", 0,                                          global_attrs->longitude))
-        return format_error_message ("Error writing global attribute", "Longitude", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "Longitude", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_double (cdf_handle, "Elevation", 0,                                          global_attrs->elevation))
-        return format_error_message ("Error writing global attribute", "Elevation", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "Elevation", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "Institution", 0,                                        global_attrs->institution))
-        return format_error_message ("Error writing global attribute", "Institution", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "Institution", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "VectorSensOrient", 0,                                   global_attrs->vector_sens_orient)) 
-        return format_error_message ("Error writing global attribute", "VectorSensOrient", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "VectorSensOrient", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "StandardLevel", 0,  imcdf_standard_level_code_tostring (global_attrs->standard_level)))
-        return format_error_message ("Error writing global attribute", "StandardLevel", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "StandardLevel", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "StandardName", 0,                                       global_attrs->standard_name))
-        return format_error_message ("Error writing global attribute", "StandardName", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "StandardName", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "StandardVersion", 0,                                    global_attrs->standard_version))
-        return format_error_message ("Error writing global attribute", "StandardVersion", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "StandardVersion", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "PartialStandDesc", 0,                                   global_attrs->partial_stand_desc))
-        return format_error_message ("Error writing global attribute", "PartialStandDesc", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "PartialStandDesc", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "Source", 0,                                             global_attrs->source))
-        return format_error_message ("Error writing global attribute", "Source", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "Source", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "TermsOfUse", 0,                                         global_attrs->terms_of_use))
-        return format_error_message ("Error writing global attribute", "TermsOfUse", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "TermsOfUse", imcdf_get_last_status_code ());
     if (imcdf_add_global_attr_string (cdf_handle, "UniqueIdentifier", 0,                                   global_attrs->unique_identifier))
-        return format_error_message ("Error writing global attribute", "UniqueIdentifier", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "UniqueIdentifier", imcdf_get_last_status_code ());
     for (count=0; count<global_attrs->n_parent_identifiers; count++)
     {
         if (imcdf_add_global_attr_string (cdf_handle, "ParentIdentifiers", count, global_attrs->parent_identifiers [count]))
-            return format_error_message ("Error writing global attribute", "ParentIdentifiers", imcdf_get_last_status_code ());
+            return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "ParentIdentifiers", imcdf_get_last_status_code ());
     }
     for (count=0; count<global_attrs->n_reference_links; count++)
     {
         if (imcdf_add_global_attr_string (cdf_handle, "ReferenceLinks", count, global_attrs->reference_links [count]))
-            return format_error_message ("Error writing global attribute", "ReferenceLinks", imcdf_get_last_status_code ());
+            return format_error_message (IMCDF_ERROR_CDF, "Error writing global attribute", "ReferenceLinks", imcdf_get_last_status_code ());
     }
 
     return 0;
@@ -445,6 +1622,7 @@ char *imcdf_write_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_a
 
 /*****************************************************************************
  * imcdf_write_variable
+ * imcdf_write_variable_opt
  *
  * Description: write a variable and its metadata to an ImagCDF file
  *
@@ -458,6 +1636,9 @@ char *imcdf_write_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_a
  *                        For geomagnetic scalar data: GeomagneticScalarTimes
  *                        For temperature data: Temperature<n>Times
  *                        For any other data: return an error
+ *                   options - for imcdf_write_variable_opt, the compression
+ *                             and blocking factor for the variable, or null
+ *                             for the defaults
  * Output parameters: none
  * Returns: null for success, an error message if there was a fault
  *
@@ -465,19 +1646,25 @@ char *imcdf_write_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_a
 char *imcdf_write_variable (int cdf_handle, struct IMCDFVariable *variable,
                             int use_given_depend_0)
 
+{
+    return imcdf_write_variable_opt (cdf_handle, variable, use_given_depend_0, 0);
+}
+
+
+char *imcdf_write_variable_opt (int cdf_handle, struct IMCDFVariable *variable,
+                                int use_given_depend_0, struct IMCDFVarOptions *options)
+
 {
 
-    char var_name [30], depend_0 [50], *ptr, lablaxis [30];
+    char var_name [IMCDF_VAR_NAME_LEN], depend_0 [50], lablaxis [30];
     
     /* create the variable name */
-    ptr = create_var_name (variable->var_type, variable->elem_rec);
-    if (! ptr) 
-        return format_error_message ("Invalid variable type", 0, CDF_OK);
-    strcpy (var_name, ptr);
+    if (! create_var_name (variable->var_type, variable->elem_rec, var_name)) 
+        return format_error_message (IMCDF_ERROR_INVALID_ARGUMENT, "Invalid variable type", 0, CDF_OK);
     
     /* write the data */
-    if (imcdf_create_data_array (cdf_handle, var_name, variable->data, variable->data_len)) 
-        return format_error_message ("Error writing variable data", var_name, CDF_OK);
+    if (imcdf_create_data_array_opt (cdf_handle, var_name, variable->data, variable->data_len, options)) 
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable data", var_name, imcdf_get_last_status_code ());
     
     /* write the metadata - ignore the DEPEND_0 value in the 'variable' structure and construct a value from the data */
     if (use_given_depend_0) {
@@ -490,7 +1677,7 @@ char *imcdf_write_variable (int cdf_handle, struct IMCDFVariable *variable,
       else
       {
           if (variable->var_type != IMCDF_VARTYPE_TEMPERATURE)
-              return format_error_message ("Missing or invalid element code", 0, CDF_OK);
+              return format_error_message (IMCDF_ERROR_INVALID_ARGUMENT, "Missing or invalid element code", 0, CDF_OK);
           sprintf (depend_0, TEMPERATURE_TIME_STAMPS_VAR_NAME_BASE, variable->elem_rec);
       }
     }
@@ -501,32 +1688,38 @@ char *imcdf_write_variable (int cdf_handle, struct IMCDFVariable *variable,
         strcpy (lablaxis, variable->elem_rec);
     
     if (imcdf_add_variable_attr_string (cdf_handle, "FIELDNAM",      var_name, variable->field_nam))
-        return format_error_message ("Error writing variable attribute", "FIELDNAM", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable attribute", "FIELDNAM", imcdf_get_last_status_code ());
     if (imcdf_add_variable_attr_string (cdf_handle, "UNITS",         var_name, variable->units))
-        return format_error_message ("Error writing variable attribute", "UNITS", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable attribute", "UNITS", imcdf_get_last_status_code ());
     if (imcdf_add_variable_attr_double (cdf_handle, "FILLVAL",       var_name, variable->fill_val))
-        return format_error_message ("Error writing variable attribute", "FILLVAL", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable attribute", "FILLVAL", imcdf_get_last_status_code ());
     if (imcdf_add_variable_attr_double (cdf_handle, "VALIDMIN",      var_name, variable->valid_min))
-        return format_error_message ("Error writing variable attribute", "VALIDMIN", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable attribute", "VALIDMIN", imcdf_get_last_status_code ());
     if (imcdf_add_variable_attr_double (cdf_handle, "VALIDMAX",      var_name, variable->valid_max))
-        return format_error_message ("Error writing variable attribute", "VALIDMAX", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable attribute", "VALIDMAX", imcdf_get_last_status_code ());
     if (imcdf_add_variable_attr_string (cdf_handle, "DEPEND_0",      var_name, depend_0))
-        return format_error_message ("Error writing variable attribute", "DEPEND_0", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable attribute", "DEPEND_0", imcdf_get_last_status_code ());
     if (imcdf_add_variable_attr_string (cdf_handle, "DISPLAY_TYPE",  var_name, "time_series"))
-        return format_error_message ("Error writing variable attribute", "DISPLAY_TYPE", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable attribute", "DISPLAY_TYPE", imcdf_get_last_status_code ());
     if (imcdf_add_variable_attr_string (cdf_handle, "LABLAXIS",      var_name, lablaxis)) 
-        return format_error_message ("Error writing variable attribute", "LABLAXIS", imcdf_get_last_status_code ());
+        return format_error_message (IMCDF_ERROR_CDF, "Error writing variable attribute", "LABLAXIS", imcdf_get_last_status_code ());
     
     return 0;
 }
 
 /*****************************************************************************
  * imcdf_write_time_stamps
+ * imcdf_write_time_stamps_opt
  *
  * Description: write a set of time stamps to an ImagCDF file
  *
  * Input parameters: cdf_handle - handle to the CDF file
- *                   ts - the time stamps to write
+ *                   ts - the time stamps to write - time stamps in the 
+ *                        compact form are written a block at a time without
+ *                        expanding the whole array
+ *                   options - for imcdf_write_time_stamps_opt, the compression
+ *                             and blocking factor for the variable, or null
+ *                             for the defaults
  * Output parameters: none
  * Returns: null for success, an error message if there was a fault
  *
@@ -534,14 +1727,104 @@ char *imcdf_write_variable (int cdf_handle, struct IMCDFVariable *variable,
 char *imcdf_write_time_stamps (int cdf_handle, struct IMCDFVariableTS *ts)
 
 {
+    return imcdf_write_time_stamps_opt (cdf_handle, ts, 0);
+}
+
+
+char *imcdf_write_time_stamps_opt (int cdf_handle, struct IMCDFVariableTS *ts,
+                                   struct IMCDFVarOptions *options)
+
+{
+    int first_rec, n_block, count, result;
+    long long *buffer;
+    struct IMCDFVarOptions compact_options;
     
     /* write the data */
-    if (imcdf_create_time_stamp_array (cdf_handle, ts->var_name, ts->time_stamps, ts->data_len))
-        return format_error_message ("Error writing time stamp data", ts->var_name, CDF_OK);
+    if (ts->time_stamps || ts->data_len <= 0)
+    {
+        if (imcdf_create_time_stamp_array_opt (cdf_handle, ts->var_name, ts->time_stamps, ts->data_len, options))
+            return format_error_message (IMCDF_ERROR_CDF, "Error writing time stamp data", ts->var_name, imcdf_get_last_status_code ());
+        return 0;
+    }
+
+    /* write time stamps in the compact form a block at a time */
+    if (options) compact_options = *options;
+    else imcdf_init_var_options (&compact_options);
+    compact_options.expected_records = ts->data_len;
+    n_block = ts->data_len < IMCDF_DEFAULT_WRITE_CHUNK_SIZE ? ts->data_len : IMCDF_DEFAULT_WRITE_CHUNK_SIZE;
+    buffer = malloc (sizeof (long long) * n_block);
+    if (! buffer)
+        return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", ts->var_name, CDF_OK);
+    for (first_rec=0; first_rec<ts->data_len; first_rec += n_block)
+    {
+        if (n_block > ts->data_len - first_rec) n_block = ts->data_len - first_rec;
+        for (count=0; count<n_block; count++)
+            *(buffer + count) = ts->start + ((long long) (first_rec + count) * ts->step);
+        if (first_rec == 0)
+            result = imcdf_create_time_stamp_array_opt (cdf_handle, ts->var_name, buffer, n_block, &compact_options);
+        else
+            result = imcdf_append_time_stamp_array (cdf_handle, ts->var_name, buffer, n_block);
+        if (result)
+        {
+            free (buffer);
+            return format_error_message (IMCDF_ERROR_CDF, "Error writing time stamp data", ts->var_name, imcdf_get_last_status_code ());
+        }
+    }
+    if (options) options->compress_type_used = compact_options.compress_type_used;
+    free (buffer);
     return 0;
     
 }
 
+/** ------------------------------------------------------------------------
+ *  ---------------------------- Error reporting ---------------------------
+ *  ------------------------------------------------------------------------*/
+
+/*****************************************************************************
+ * imcdf_get_last_error
+ *
+ * Description: get the details of the last error returned to the calling 
+ *              thread by the routines in this file - each thread has its
+ *              own copy of the error, so the error messages returned by
+ *              these routines are not changed by calls from other threads
+ *
+ * Input parameters:
+ * Output parameters: error - a copy of the error details - the code is
+ *                            IMCDF_ERROR_NONE if no error has been reported
+ * Returns: the error code
+ *
+ *****************************************************************************/
+enum IMCDFErrorCode imcdf_get_last_error (struct IMCDFError *error)
+
+{
+    if (error) *error = last_error;
+    return last_error.code;
+}
+
+/*****************************************************************************
+ * imcdf_format_error
+ *
+ * Description: record an error for the calling thread in the same way as the
+ *              routines in this file - for use by the other parts of the 
+ *              library that return error messages
+ *
+ * Input parameters: code - the type of error
+ *                   msg - the error message
+ *                   param - the attribute, variable or value that the error
+ *                           relates to, may be null
+ *                   cdf_status - the CDF library status, CDF_OK if the error 
+ *                                didn't come from the library
+ * Output parameters:
+ * Returns: the formatted error message
+ *
+ *****************************************************************************/
+char *imcdf_format_error (enum IMCDFErrorCode code, char *msg, char *param, 
+                          CDFstatus cdf_status)
+
+{
+    return format_error_message (code, msg, param, cdf_status);
+}
+
 /** ------------------------------------------------------------------------
  *  ---------------------------- Useful utilities --------------------------
  *  ------------------------------------------------------------------------*/
@@ -728,17 +2011,194 @@ static int is_blank (char *s)
     return 0;
 }
     
-static char *create_var_name (enum IMCDFVariableType var_type, char *elem_rec)
+/* read the global attributes, allocating memory from an arena or, if 
+ * arena is null, with malloc () */
+static char *read_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_attrs,
+                               struct IMCDFArena *arena)
+{
+
+    char *pl_str, *sl_str, *err_msg;
+
+    /* get the global attributes */
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "FormatDescription",    0, arena, &(global_attrs->format_description))) 
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "FormatDescription", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "FormatVersion",        0, arena, &(global_attrs->format_version)))     
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "FormatVersion", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "Title",                0, arena, &(global_attrs->title)))              
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "Title", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "IagaCode",             0, arena, &(global_attrs->iaga_code)))          
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "IagaCode", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "ElementsRecorded",     0, arena, &(global_attrs->elements_recorded)))  
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "ElementsRecorded", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "PublicationLevel",     0, arena, &pl_str))                             
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "PublicationLevel", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_tt2000 (cdf_handle, "PublicationDate",      0, &(global_attrs->pub_date)))           
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "PublicationDate", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "ObservatoryName",      0, arena, &(global_attrs->observatory_name)))   
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "ObservatoryName", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_double (cdf_handle, "Latitude",             0, &(global_attrs->latitude)))           
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "Latitude", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_double (cdf_handle, "Longitude",            0, &(global_attrs->longitude)))          
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "Longitude", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_double (cdf_handle, "Elevation",            0, &(global_attrs->elevation)))          
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "Elevation", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "Institution",          0, arena, &(global_attrs->institution)))        
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "Institution", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "VectorSensOrient",     0, arena, &(global_attrs->vector_sens_orient))) 
+      global_attrs->vector_sens_orient = 0;
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "StandardLevel",        0, arena, &sl_str))                             
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "StandardLevel", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "StandardName",         0, arena, &(global_attrs->standard_name)))      
+      global_attrs->standard_name = 0;;
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "StandardVersion",      0, arena, &(global_attrs->standard_version)))   
+      global_attrs->standard_version = 0;
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "PartialStandDesc",     0, arena, &(global_attrs->partial_stand_desc))) 
+      global_attrs->partial_stand_desc = 0;;
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "Source",               0, arena, &(global_attrs->source)))             
+      return format_error_message (IMCDF_ERROR_CDF, "Error reading global attribute", "Source", imcdf_get_last_status_code ());
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "TermsOfUse",           0, arena, &(global_attrs->terms_of_use)))       
+      global_attrs->terms_of_use = 0;
+    if (imcdf_get_global_attribute_string_arena (cdf_handle, "UniqueIdentifier",     0, arena, &(global_attrs->unique_identifier)))  
+      global_attrs->unique_identifier = 0;
+    global_attrs->pub_level = imcdf_parse_pub_level_string (pl_str);
+    global_attrs->standard_level = imcdf_parse_standard_level_string (sl_str);
+    if (! arena)
+    {
+        free (pl_str);
+        free (sl_str);
+    }
+    err_msg = read_global_attr_list (cdf_handle, "ParentIdentifiers", arena, 
+                                     &(global_attrs->parent_identifiers), &(global_attrs->n_parent_identifiers));
+    if (err_msg) return err_msg;
+    err_msg = read_global_attr_list (cdf_handle, "ReferenceLinks", arena, 
+                                     &(global_attrs->reference_links), &(global_attrs->n_reference_links));
+    if (err_msg) return err_msg;
+
+    return check_global_attrs (global_attrs);
+}
+
+/* read all the entries of a global attribute that may have more than one
+ * entry, allocating memory from an arena or, if arena is null, with malloc () */
+static char *read_global_attr_list (int cdf_handle, char *name, struct IMCDFArena *arena,
+                                    char ***list, int *n_entries)
+{
+    int capacity;
+    char *str, **new_list;
+
+    *list = 0;
+    *n_entries = capacity = 0;
+    while (! imcdf_get_global_attribute_string_arena (cdf_handle, name, *n_entries, arena, &str))
+    {
+        if (*n_entries >= capacity)
+        {
+            capacity = capacity ? capacity * 2 : 4;
+            if (arena)
+            {
+                new_list = imcdf_arena_alloc (arena, sizeof (char *) * capacity);
+                if (new_list && *n_entries) memcpy (new_list, *list, sizeof (char *) * (*n_entries));
+            }
+            else
+                new_list = realloc (*list, sizeof (char *) * capacity);
+            if (! new_list)
+            {
+                if (! arena) free (str);
+                return format_error_message (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", name, CDF_OK);
+            }
+            *list = new_list;
+        }
+        (*list) [(*n_entries) ++] = str;
+    }
+    return 0;
+}
+
+/* find the ImagCDF global attribute that an entry holds - returns the index
+ * into standard_global_attrs or -1 if the entry is not part of ImagCDF (or 
+ * has an unexpected type or size, or is an extra entry of a single valued 
+ * attribute) */
+static int find_standard_global_attr (char *name, int entry_no, long data_type, int n_elements)
+{
+    int count;
+    struct StandardGlobalAttr *std_attr;
+
+    for (count=0; count<N_STANDARD_GLOBAL_ATTRS; count++)
+    {
+        std_attr = standard_global_attrs + count;
+        if (strcmp (name, std_attr->name)) continue;
+        if (std_attr->type != GA_STRING_LIST && entry_no != 0) return -1;
+        switch (std_attr->type)
+        {
+        case GA_DOUBLE:
+            if (data_type != CDF_DOUBLE || n_elements != 1) return -1;
+            break;
+        case GA_TT2000:
+            if (data_type != CDF_TIME_TT2000 || n_elements != 1) return -1;
+            break;
+        default:
+            if (data_type != CDF_CHAR) return -1;
+            break;
+        }
+        return count;
+    }
+    return -1;
+}
+
+/* check the metadata in a set of global attributes */
+static char *check_global_attrs (struct IMCDFGlobalAttr *global_attrs)
+{
+    int imcdf_version;
+    char *ptr;
+
+    if (strcasecmp (global_attrs->title,              "Geomagnetic time series data")) 
+        return format_error_message (IMCDF_ERROR_INVALID_FORMAT, "Title of data incorrect", global_attrs->title, CDF_OK);
+    if (strcasecmp (global_attrs->format_description, "INTERMAGNET CDF Format"))
+        return format_error_message (IMCDF_ERROR_INVALID_FORMAT, "Description of data incorrect", global_attrs->format_description, CDF_OK);
+    imcdf_version = (int) ((strtod (global_attrs->format_version, &ptr) * 10.0) + 0.5);
+    if (imcdf_version < 11 || imcdf_version > 13)
+        return format_error_message (IMCDF_ERROR_INVALID_FORMAT, "Format incorrect", global_attrs->format_version, CDF_OK);
+    return 0;
+}
+
+/* work out the type and element of a listed variable from its name and
+ * data type - the reverse of create_var_name () */
+static void classify_variable (struct IMCDFVariableInfo *info)
+{
+    int length;
+    char *elem_rec;
+
+    info->var_type = IMCDF_VARTYPE_ERROR;
+    info->elem_rec [0] = '\0';
+    info->is_time_stamps = (info->data_type == CDF_TIME_TT2000);
+    if (info->is_time_stamps) return;
+
+    length = strlen ("GeomagneticField");
+    if (! strncmp (info->var_name, "GeomagneticField", length))
+        info->var_type = IMCDF_VARTYPE_GEOMAGNETIC_FIELD_ELEMENT;
+    else
+    {
+        length = strlen ("Temperature");
+        if (! strncmp (info->var_name, "Temperature", length))
+            info->var_type = IMCDF_VARTYPE_TEMPERATURE;
+    }
+    if (info->var_type == IMCDF_VARTYPE_ERROR) return;
+
+    elem_rec = info->var_name + length;
+    if (is_blank (elem_rec) || strlen (elem_rec) >= sizeof (info->elem_rec))
+        info->var_type = IMCDF_VARTYPE_ERROR;
+    else
+        strcpy (info->elem_rec, elem_rec);
+}
+
+/* create the name of a variable in var_name, which must be at least
+ * IMCDF_VAR_NAME_LEN long - returns var_name or null if the type is invalid */
+static char *create_var_name (enum IMCDFVariableType var_type, char *elem_rec, char *var_name)
 {
-    static char var_name [30];
-    
     switch (var_type)
     {
     case IMCDF_VARTYPE_GEOMAGNETIC_FIELD_ELEMENT:
-        sprintf (var_name, "GeomagneticField%s", elem_rec);
+        snprintf (var_name, IMCDF_VAR_NAME_LEN, "GeomagneticField%s", elem_rec);
         break;
     case IMCDF_VARTYPE_TEMPERATURE:
-        sprintf (var_name, "Temperature%s", elem_rec);
+        snprintf (var_name, IMCDF_VAR_NAME_LEN, "Temperature%s", elem_rec);
         break;
     default:
         return 0;
@@ -746,24 +2206,106 @@ static char *create_var_name (enum IMCDFVariableType var_type, char *elem_rec)
     return var_name;
 }    
 
-static char *format_error_message (char *msg, char *param, int cdf_status)
+/* read the metadata for a variable - on success the variable's name is
+ * returned in var_name - if str_buffer is null the metadata strings are 
+ * allocated from the arena or, if that is also null, dynamically, otherwise
+ * they are stored in str_buffer and, if str_needed is not null, it is set to
+ * the number of bytes of str_buffer that the strings need, whether or not
+ * they fitted */
+static char *read_variable_metadata (int cdf_handle, enum IMCDFVariableType var_type, 
+                                     char *elem_rec, struct IMCDFVariable *variable,
+                                     char *var_name, char *str_buffer, int str_buffer_len,
+                                     int *str_needed, struct IMCDFArena *arena)
+{
+    int result, too_small;
+
+    /* create the variable name */
+    if (! create_var_name (var_type, elem_rec, var_name)) 
+        return format_error_message (IMCDF_ERROR_INVALID_ARGUMENT, "Invalid variable type", 0, CDF_OK);
+    
+    /* read the variable metadata - a string that doesn't fit in str_buffer
+     * doesn't stop the others being measured */
+    variable->var_type = var_type;
+    strcpy (variable->elem_rec, elem_rec);
+    if (str_needed) *str_needed = 0;
+    result = get_variable_attribute_string (cdf_handle, "FIELDNAM",  var_name, &(variable->field_nam), &str_buffer, &str_buffer_len, str_needed, arena);
+    if (result < 0)
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading variable attribute", "FIELDNAM", imcdf_get_last_status_code ());
+    too_small = result;
+    result = get_variable_attribute_string (cdf_handle, "UNITS",     var_name, &(variable->units), &str_buffer, &str_buffer_len, str_needed, arena);
+    if (result < 0)
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading variable attribute", "UNITS", imcdf_get_last_status_code ());
+    too_small |= result;
+    if (imcdf_get_variable_attribute_double (cdf_handle, "FILLVAL",   var_name, &(variable->fill_val)))
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading variable attribute", "FILLVAL", imcdf_get_last_status_code ());
+    if (imcdf_get_variable_attribute_double (cdf_handle, "VALIDMIN",  var_name, &(variable->valid_min)))
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading variable attribute", "VALIDMIN", imcdf_get_last_status_code ());
+    if (imcdf_get_variable_attribute_double (cdf_handle, "VALIDMAX",  var_name, &(variable->valid_max)))
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading variable attribute", "VALIDMAX", imcdf_get_last_status_code ());
+    result = get_variable_attribute_string (cdf_handle, "DEPEND_0",  var_name, &(variable->depend_0), &str_buffer, &str_buffer_len, str_needed, arena);
+    if (result < 0)
+        return format_error_message (IMCDF_ERROR_CDF, "Error reading variable attribute", "DEPEND_0", imcdf_get_last_status_code ());
+    too_small |= result;
+
+    if (too_small)
+        return format_error_message (IMCDF_ERROR_BUFFER_TOO_SMALL, "Buffer too small for variable metadata", var_name, CDF_OK);
+    return 0;
+}
+
+/* get a string variable attribute - if *str_buffer is null the string is
+ * allocated from the arena (or dynamically if the arena is null), otherwise
+ * it is stored at the start of *str_buffer and *str_buffer and 
+ * *str_buffer_len are moved past it, and the space it needs is added to
+ * *str_needed (if str_needed is not null). Returns 0 for success, 1 if the
+ * string didn't fit in *str_buffer (after which nothing more is stored
+ * there), -1 for failure */
+static int get_variable_attribute_string (int cdf_handle, char *attr_name, char *var_name,
+                                          char **value, char **str_buffer, int *str_buffer_len,
+                                          int *str_needed, struct IMCDFArena *arena)
+{
+    int length, result;
+
+    if (! *str_buffer)
+        return imcdf_get_variable_attribute_string_arena (cdf_handle, attr_name, var_name, arena, value) ? -1 : 0;
+
+    result = imcdf_get_variable_attribute_string_into (cdf_handle, attr_name, var_name, 
+                                                       *str_buffer, *str_buffer_len, &length);
+    if (result < 0) return -1;
+    if (str_needed) *str_needed += length +1;
+    if (result > 0)
+    {
+        *value = 0;
+        *str_buffer_len = 0;
+        return 1;
+    }
+    *value = *str_buffer;
+    *str_buffer += length +1;
+    *str_buffer_len -= length +1;
+    return 0;
+}
+
+/* record an error in the calling thread's error structure and return its
+ * message */
+static char *format_error_message (enum IMCDFErrorCode code, char *msg, char *param, 
+                                  CDFstatus cdf_status)
 {
 
-  static char buffer [200];
+  int length;
+  char status_msg [IMCDF_STATUS_STRING_LEN];
+
+  last_error.code = code;
+  last_error.cdf_status = cdf_status;
+  snprintf (last_error.param, sizeof (last_error.param), "%s", param ? param : "");
 
-  strcpy (buffer, msg);
   if (param)
-  {
-    strcat (buffer, ": ");
-    strcat (buffer, param);
-  }
-  if (cdf_status != CDF_OK)
-  {
-    strcat (buffer, " [CDF error: ]");
-    strcat (buffer, imcdf_status_code_tostring (imcdf_get_last_status_code ()));
-  }
-
-  return buffer;
+    length = snprintf (last_error.message, sizeof (last_error.message), "%s: %s", msg, param);
+  else
+    length = snprintf (last_error.message, sizeof (last_error.message), "%s", msg);
+  if (cdf_status != CDF_OK && length >= 0 && length < (int) sizeof (last_error.message))
+    snprintf (last_error.message + length, sizeof (last_error.message) - length,
+              " [CDF error: ]%s", imcdf_status_code_tostring_r (cdf_status, status_msg));
+
+  return last_error.message;
 
 }
 
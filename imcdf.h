@@ -10,7 +10,16 @@
  * Updates to version 1.3 of ImagCDF. Simon Flower, 09/09/2025
  *****************************************************************************/
 
+#include <stdio.h>
+
 #include "cdf.h" 
+
+/* storage class for data that is held separately by each thread */
+#if defined (__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define IMCDF_THREAD_LOCAL _Thread_local
+#else
+#define IMCDF_THREAD_LOCAL __thread
+#endif
  
 /* enumerations for the metadata elements that hold structured text */ 
 enum IMCDFPubLevel {IMCDF_PUBLEVEL_1=1, IMCDF_PUBLEVEL_2=2, IMCDF_PUBLEVEL_3=3, IMCDF_PUBLEVEL_4=4};
@@ -32,22 +41,83 @@ enum IMCDFOpenType { IMCDF_FORCE_CREATE, IMCDF_CREATE, IMCDF_OPEN };
  *     RLE - run length encoding
  *     HUFF - Huffman encoding
  *     AHUFF - Adaptive Huffman encoding
- *     GZIP<n> - GZIP level 1 to 9 (9 = greatest compression) */
+ *     GZIP<n> - GZIP level 1 to 9 (9 = greatest compression)
+ *     INHERIT - for a variable, don't compress the variable itself, but use
+ *               the compression set for the whole file (for a file, the 
+ *               same as NONE)
+ *     AUTO - for a variable, choose the compression by trying each type on
+ *            a sample of the data and using the one that gives the smallest
+ *            output (for a file, the same as NONE). Each variable created
+ *            this way writes and deletes up to 7 scratch CDF files in
+ *            $TMPDIR (or /tmp) */
 enum IMCDFCompressionType {IMCDF_COMPRESS_NONE, IMCDF_COMPRESS_RLE,
                            IMCDF_COMPRESS_HUFF, IMCDF_COMPRESS_AHUFF,
                            IMCDF_COMPRESS_GZIP1, IMCDF_COMPRESS_GZIP2,
                            IMCDF_COMPRESS_GZIP3, IMCDF_COMPRESS_GZIP4,
                            IMCDF_COMPRESS_GZIP5, IMCDF_COMPRESS_GZIP6,
                            IMCDF_COMPRESS_GZIP7, IMCDF_COMPRESS_GZIP8,
-                           IMCDF_COMPRESS_GZIP9};
+                           IMCDF_COMPRESS_GZIP9, IMCDF_COMPRESS_INHERIT,
+                           IMCDF_COMPRESS_AUTO};
 
 /* an enumeration describing both the cadence and the coverage of the data */
 enum IMCDFInterval {IMCDF_INT_UNKNOWN, IMCDF_INT_ANNUAL, IMCDF_INT_MONTHLY, IMCDF_INT_DAILY, 
                     IMCDF_INT_HOURLY, IMCDF_INT_MINUTE, IMCDF_INT_SECOND};
 
+/* the default number of records passed to the CDF library in each call
+ * when writing data - see imcdf_set_write_chunk_size() */
+#define IMCDF_DEFAULT_WRITE_CHUNK_SIZE 65536
+
+/* the default number of records requested from the CDF library in each call
+ * when reading data - see imcdf_set_read_chunk_size() */
+#define IMCDF_DEFAULT_READ_CHUNK_SIZE 65536
+
+/* the number of records in each block of a variable (the unit in which the
+ * CDF library allocates and compresses records) when no blocking factor is
+ * given - variables with up to IMCDF_SINGLE_BLOCK_MAX_RECORDS records (a 
+ * day of minute data) are written as a single block, longer variables use 
+ * blocks of IMCDF_DEFAULT_BLOCKING_FACTOR records (an hour of second data) */
+#define IMCDF_SINGLE_BLOCK_MAX_RECORDS  1440
+#define IMCDF_DEFAULT_BLOCKING_FACTOR   3600
+
+/* the number of records used to choose the compression for a variable with
+ * IMCDF_COMPRESS_AUTO and the default limit on the CPU time (in milliseconds)
+ * spent trying different types of compression on each variable */
+#define IMCDF_AUTO_SAMPLE_RECORDS        4096
+#define IMCDF_DEFAULT_AUTO_CPU_BUDGET    250
+
+/* sizes of buffers used to hold strings created by the library */
+#define IMCDF_VAR_NAME_LEN          30
+#define IMCDF_TT2000_STRING_LEN     30
+#define IMCDF_STATUS_STRING_LEN     (CDF_STATUSTEXT_LEN +30)
+#define IMCDF_ERROR_PARAM_LEN       100
+#define IMCDF_ERROR_MESSAGE_LEN     (IMCDF_STATUS_STRING_LEN +200)
+#define IMCDF_NUMBER_STRING_LEN     64
+
+/* the size of the buffer used when writing text */
+#define IMCDF_TEXT_BUFFER_SIZE      65536
+
+/* the alignment of the data columns read by imcdf_read_file () */
+#define IMCDF_COLUMN_ALIGN          64
+
+/* the number of time stamp variables a reader (see IMCDFReader) keeps from
+ * each file */
+#define IMCDF_READER_MAX_TIME_AXES  8
+
+/* the default size of each block of memory in an arena (see IMCDFArena) 
+ * and the alignment of memory allocated from an arena */
+#define IMCDF_ARENA_BLOCK_SIZE      65536
+#define IMCDF_ARENA_ALIGN           16
+
 /* the value used to represent missing data */
 #define IMCDF_MISSING_DATA_VALUE 99999.0
 
+/* the value used in IAGA-2002 files for an element that is not recorded */
+#define IMCDF_NOT_RECORDED_VALUE 88888.0
+
+/* time stamps that may be used as the ends of a time range to include all data */
+#define IMCDF_TT2000_EARLIEST   (-9223372036854775807LL -1LL)
+#define IMCDF_TT2000_LATEST     9223372036854775807LL
+
 /* names of time stamp variables in the CDF file */
 #define DATA_TIMES_VAR_NAME                     "DataTimes"
 #define GEOMAG_TIMES_VAR_NAME                   "GeomagneticTimes"
@@ -104,14 +174,118 @@ struct IMCDFGlobalAttr
     /* enum IMCDFStandards standards_conformance; */
 };
 
-/* a structure that holds an ImagCDF time stamp array */
+/* a global attribute entry that is not part of the ImagCDF format, kept by
+ * imcdf_read_global_attr_set () so that no metadata is lost - value holds
+ * n_elements values of the CDF data_type as they are stored in the file, 
+ * and CDF_CHAR values are also null terminated */
+struct IMCDFExtraAttr
+{
+    char *name;
+    int entry_no;
+    long data_type;
+    int n_elements;
+    void *value;
+};
+
+/* the global attributes from an ImagCDF file, read in one pass by
+ * imcdf_read_global_attr_set () - the strings and arrays in global_attrs
+ * and the extra attributes are all held in a single block of memory, so 
+ * free them with imcdf_free_global_attr_set (), not imcdf_free_global_attrs () */
+struct IMCDFGlobalAttrSet
+{
+    struct IMCDFGlobalAttr global_attrs;
+    /* attributes, or entries of attributes, that are not in the ImagCDF format */
+    struct IMCDFExtraAttr *extra_attrs;
+    int n_extra_attrs;
+    /* storage for the strings and arrays */
+    char *storage;
+};
+
+/* a structure that holds an ImagCDF time stamp array - time stamps at a 
+ * regular cadence may be held in a compact form, where time_stamps is null
+ * and time stamp n is (start + (n * step)) - use imcdf_get_time_stamp () to
+ * read time stamps that may be held in either form */
 struct IMCDFVariableTS
 {
     char *var_name;
     long long *time_stamps;
     int data_len;
+    /* the compact form - only used when time_stamps is null */
+    long long start;
+    long long step;
+};
+
+/* a structure that holds a TT2000 time stamp broken down to a calendar
+ * date and time - sec may be 60 during a leap second */
+struct IMCDFDateTime
+{
+    int year;
+    int month;
+    int day;
+    int hour;
+    int min;
+    int sec;
 };
 
+/* an arena (or region) of memory - everything allocated from an arena is 
+ * taken from a few large blocks and is released together by 
+ * imcdf_arena_free (), or made available for reuse by imcdf_arena_reset () -
+ * set it up with imcdf_arena_init () */
+struct IMCDFArenaBlock
+{
+    struct IMCDFArenaBlock *next;
+    size_t size;
+    size_t used;
+};
+struct IMCDFArena
+{
+    /* the blocks, in the order they were allocated, and the block that
+     * memory is currently being taken from */
+    struct IMCDFArenaBlock *first;
+    struct IMCDFArenaBlock *current;
+    size_t block_size;
+};
+
+/* settings and reusable memory for reading many ImagCDF files, one after
+ * another - set it up with imcdf_reader_init (). Everything read through 
+ * the reader is held in its arena, which is kept when a file is closed and 
+ * reused when the next file is opened, so a reader that has reached its
+ * largest file allocates no more memory. Time stamp variables are read once
+ * per file and shared between the variables that use them */
+struct IMCDFReader
+{
+    /* the open file, -1 if no file is open */
+    int cdf_handle;
+    /* the read chunk size applied to each file (see imcdf_set_read_chunk_size),
+     * 0 for the default */
+    int read_chunk_size;
+    /* memory for everything read from the current file */
+    struct IMCDFArena arena;
+    /* the time stamp variables read from the current file */
+    struct IMCDFVariableTS time_axes [IMCDF_READER_MAX_TIME_AXES];
+    char time_axis_names [IMCDF_READER_MAX_TIME_AXES] [IMCDF_VAR_NAME_LEN];
+    int n_time_axes;
+};
+
+/* a structure that buffers text written to a stream or file descriptor - 
+ * use imcdf_text_writer_init () to set it up */
+struct IMCDFTextWriter
+{
+    FILE *file;                 /* the stream to write to, or null to use fd */
+    int fd;
+    int used;                   /* the amount of text in the buffer */
+    int error;                  /* set if a write has failed */
+    char buffer [IMCDF_TEXT_BUFFER_SIZE];
+};
+
+/* the formats of text file that can be imported */
+enum IMCDFImportFormat {IMCDF_IMPORT_UNKNOWN, IMCDF_IMPORT_IAGA2002, IMCDF_IMPORT_IMF};
+
+/* the maximum number of geomagnetic elements in an imported file and the
+ * maximum length of the name of a file created by an import */
+#define IMCDF_IMPORT_MAX_ELEMENTS   4
+#define IMCDF_FILENAME_LEN          1024
+
 /* a structure that holds an ImagCDF variable along with it's metadata */
 struct IMCDFVariable
 {
@@ -136,21 +310,206 @@ struct IMCDFVariable
     /* double orig_freq; */
 };
 
+/* options used when creating a variable - initialise with imcdf_init_var_options ():
+ *     compress_type - compression for the variable
+ *     blocking_factor - the number of records in each block, 0 for the default
+ *     expected_records - the number of records the variable is expected to
+ *                        hold when data will be added after it is created
+ *                        (e.g. in a streaming session), 0 if not known
+ *     auto_cpu_budget - for IMCDF_COMPRESS_AUTO, the CPU time in milliseconds
+ *                       that the calling thread may spend choosing the
+ *                       compression, 0 for the default - once this is used
+ *                       up no more types of compression are tried
+ *     compress_type_used - set when the variable is created to the compression
+ *                          that was used - for IMCDF_COMPRESS_AUTO this is the
+ *                          type that was chosen, or IMCDF_COMPRESS_INHERIT if
+ *                          there was no data to choose with */
+struct IMCDFVarOptions
+{
+    enum IMCDFCompressionType compress_type;
+    int blocking_factor;
+    int expected_records;
+    int auto_cpu_budget;
+    enum IMCDFCompressionType compress_type_used;
+};
+
+/* an enumeration of the types of error that the routines in imcdf.c report:
+ *     NONE - no error has been reported
+ *     CDF - an error was reported by the CDF library
+ *     NO_MEMORY - memory could not be allocated
+ *     INVALID_ARGUMENT - a parameter to the routine was invalid
+ *     BUFFER_TOO_SMALL - a buffer supplied by the caller was too small
+ *     INVALID_FORMAT - the file does not conform to the ImagCDF format
+ *     WRITE - text could not be written to a stream or file */
+enum IMCDFErrorCode {IMCDF_ERROR_NONE, IMCDF_ERROR_CDF, IMCDF_ERROR_NO_MEMORY,
+                     IMCDF_ERROR_INVALID_ARGUMENT, IMCDF_ERROR_BUFFER_TOO_SMALL,
+                     IMCDF_ERROR_INVALID_FORMAT, IMCDF_ERROR_WRITE};
+
+/* a structure that holds the details of an error - see imcdf_get_last_error () */
+struct IMCDFError
+{
+    enum IMCDFErrorCode code;
+    /* the CDF library status, CDF_OK if the error didn't come from the library */
+    CDFstatus cdf_status;
+    /* the attribute, variable or value that the error relates to, may be empty */
+    char param [IMCDF_ERROR_PARAM_LEN];
+    /* the full error message, as returned by the routine that failed */
+    char message [IMCDF_ERROR_MESSAGE_LEN];
+};
+
+/* a structure that holds the contents of an IAGA-2002 or IMF file - see
+ * imcdf_read_import_file (). All variables share the one set of time
+ * stamps, which are held in the compact form when their cadence is regular */
+struct IMCDFImportData
+{
+    struct IMCDFGlobalAttr global_attrs;
+    struct IMCDFVariable variables [IMCDF_IMPORT_MAX_ELEMENTS];
+    int n_variables;
+    struct IMCDFVariableTS ts;
+    /* the cadence and coverage of the data, used to name the ImagCDF file */
+    enum IMCDFInterval cadence;
+    enum IMCDFInterval coverage;
+    /* storage for the strings in global_attrs and variables */
+    char *strings;
+};
+
+/* a whole ImagCDF file read by imcdf_read_file () - each variable's data is 
+ * a column aligned to IMCDF_COLUMN_ALIGN bytes, and each column points to
+ * its time stamps, which are read once and shared by all the columns that
+ * use them. Free it with imcdf_free_file () */
+struct IMCDFTimeAxis
+{
+    char var_name [IMCDF_VAR_NAME_LEN];
+    long long *time_stamps;
+    int n_recs;
+};
+struct IMCDFColumn
+{
+    /* the variable and its metadata - variable.data is the column */
+    struct IMCDFVariable variable;
+    struct IMCDFTimeAxis *time_axis;
+    enum IMCDFCompressionType compress_type;
+};
+struct IMCDFFile
+{
+    struct IMCDFGlobalAttr global_attrs;
+    struct IMCDFColumn *columns;
+    int n_columns;
+    struct IMCDFTimeAxis *time_axes;
+    int n_time_axes;
+    /* the memory that holds the columns and time stamps, and the arena that
+     * holds the metadata */
+    void *column_storage;
+    struct IMCDFArena arena;
+};
+
+/* a structure used to step through a variable and its time stamps a window
+ * at a time - see imcdf_iter_open () */
+struct IMCDFRecordIterator
+{
+    int cdf_handle;
+    char var_name [IMCDF_VAR_NAME_LEN];
+    /* the variable's metadata and the data in the current window */
+    struct IMCDFVariable variable;
+    /* the time stamps in the current window */
+    struct IMCDFVariableTS ts;
+    /* the record number of the start of the current window */
+    int first_rec;
+    /* the total number of records and the number of records in each window */
+    int n_recs;
+    int window_size;
+};
+
+/* a structure that describes one variable in an ImagCDF file - see
+ * imcdf_list_variables (). Variables that are not data (e.g. time stamps)
+ * have a var_type of IMCDF_VARTYPE_ERROR and an empty elem_rec */
+struct IMCDFVariableInfo
+{
+    char var_name [IMCDF_VAR_NAME_LEN];
+    enum IMCDFVariableType var_type;
+    char elem_rec [10];
+    /* true if the variable holds time stamps */
+    int is_time_stamps;
+    int n_recs;
+    /* the CDF data type - CDF_DOUBLE for data, CDF_TIME_TT2000 for time stamps */
+    long data_type;
+    /* the time stamp variable for the data - empty for time stamp variables */
+    char depend_0 [IMCDF_VAR_NAME_LEN];
+    enum IMCDFCompressionType compress_type;
+};
+
 /* forward declarations */
 /* imcdf.c */
 char *imcdf_open2 (char *filename, enum IMCDFOpenType open_type, 
                    enum IMCDFCompressionType compress_type, int *cdf_handle);
 char *imcdf_close2 (int cdf_handle);
 char *imcdf_read_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_attrs);
+char *imcdf_list_variables (int cdf_handle, struct IMCDFVariableInfo **variables,
+                            int *n_variables);
+char *imcdf_read_global_attr_set (int cdf_handle, struct IMCDFGlobalAttrSet *attr_set);
 char *imcdf_read_variable (int cdf_handle, enum IMCDFVariableType var_type, 
                            char *elem_rec, struct IMCDFVariable *variable);
+char *imcdf_read_global_attrs_arena (int cdf_handle, struct IMCDFGlobalAttr *global_attrs,
+                                    struct IMCDFArena *arena);
+char *imcdf_read_variable_arena (int cdf_handle, enum IMCDFVariableType var_type, 
+                                 char *elem_rec, struct IMCDFVariable *variable,
+                                 struct IMCDFArena *arena);
+char *imcdf_read_time_stamps_arena (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts,
+                                    struct IMCDFArena *arena);
 char *imcdf_read_time_stamps (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts);
+char *imcdf_read_variable_range (int cdf_handle, enum IMCDFVariableType var_type, 
+                                 char *elem_rec, long long start_tt2000, long long end_tt2000,
+                                 struct IMCDFVariable *variable);
+char *imcdf_read_time_stamps_compact (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts);
+char *imcdf_read_time_stamps_range (int cdf_handle, char *var_name, 
+                                    long long start_tt2000, long long end_tt2000,
+                                    struct IMCDFVariableTS *ts);
+char *imcdf_read_variable_into (int cdf_handle, enum IMCDFVariableType var_type, 
+                                char *elem_rec, struct IMCDFVariable *variable,
+                                char *str_buffer, int str_buffer_len, int *str_buffer_needed,
+                                double *data, int data_capacity);
+char *imcdf_read_time_stamps_into (int cdf_handle, char *var_name, struct IMCDFVariableTS *ts,
+                                   long long *time_stamps, int capacity);
+char *imcdf_iter_open (int cdf_handle, enum IMCDFVariableType var_type, 
+                       char *elem_rec, int window_size,
+                       struct IMCDFRecordIterator *iter);
+char *imcdf_iter_open_range (int cdf_handle, enum IMCDFVariableType var_type, 
+                             char *elem_rec, int window_size,
+                             long long start_tt2000, long long end_tt2000,
+                             struct IMCDFRecordIterator *iter);
+char *imcdf_iter_next (struct IMCDFRecordIterator *iter);
+void imcdf_iter_close (struct IMCDFRecordIterator *iter);
+void imcdf_reader_init (struct IMCDFReader *reader, size_t arena_block_size,
+                        int read_chunk_size);
+char *imcdf_reader_open (struct IMCDFReader *reader, char *filename);
+char *imcdf_reader_read_global_attrs (struct IMCDFReader *reader, 
+                                      struct IMCDFGlobalAttr *global_attrs);
+char *imcdf_reader_read_variable (struct IMCDFReader *reader, enum IMCDFVariableType var_type, 
+                                  char *elem_rec, struct IMCDFVariable *variable);
+char *imcdf_reader_read_time_stamps (struct IMCDFReader *reader, char *var_name, 
+                                     struct IMCDFVariableTS *ts);
+char *imcdf_reader_close (struct IMCDFReader *reader);
+void imcdf_reader_free (struct IMCDFReader *reader);
 void imcdf_free_global_attrs (struct IMCDFGlobalAttr *global_attrs);
+void imcdf_free_global_attr_set (struct IMCDFGlobalAttrSet *attr_set);
 void imcdf_free_variable (struct IMCDFVariable *variable);
 void imcdf_free_time_stamps (struct IMCDFVariableTS *ts);
+void imcdf_free_variable_list (struct IMCDFVariableInfo *variables);
+char *imcdf_read_file (char *filename, struct IMCDFFile *file);
+void imcdf_free_file (struct IMCDFFile *file);
+long long imcdf_get_time_stamp (struct IMCDFVariableTS *ts, int index);
+int imcdf_find_time_stamp_index (struct IMCDFVariableTS *ts, long long tt2000);
+long long *imcdf_expand_time_stamps (struct IMCDFVariableTS *ts);
 char *imcdf_write_global_attrs (int cdf_handle, struct IMCDFGlobalAttr *global_attrs);
 char *imcdf_write_variable (int cdf_handle, struct IMCDFVariable *variable, int use_given_depend_0);
 char *imcdf_write_time_stamps (int cdf_handle, struct IMCDFVariableTS *ts);
+char *imcdf_write_variable_opt (int cdf_handle, struct IMCDFVariable *variable, int use_given_depend_0,
+                                struct IMCDFVarOptions *options);
+char *imcdf_write_time_stamps_opt (int cdf_handle, struct IMCDFVariableTS *ts,
+                                   struct IMCDFVarOptions *options);
+enum IMCDFErrorCode imcdf_get_last_error (struct IMCDFError *error);
+char *imcdf_format_error (enum IMCDFErrorCode code, char *msg, char *param, 
+                          CDFstatus cdf_status);
 char *getINTERMAGNETTermsOfUse ();
 int imcdf_is_vector_gm_data (enum IMCDFVariableType var_type, char *elem_rec);
 int imcdf_is_scalar_gm_data (enum IMCDFVariableType var_type, char *elem_rec);
@@ -162,6 +521,8 @@ char *imcdf_make_filename (char *prefix, char *station_code, long long start_dat
 /* imcdf_low_level.c */
 int imcdf_open (char *filename, enum IMCDFOpenType open_type, enum IMCDFCompressionType compress_type);
 int imcdf_close (int cdf_handle);
+int imcdf_set_write_chunk_size (int cdf_handle, int chunk_size);
+int imcdf_set_read_chunk_size (int cdf_handle, int chunk_size);
 int imcdf_add_global_attr_string (int cdf_handle, char *name, int entry_no, char *value);
 int imcdf_add_global_attr_double (int cdf_handle, char *name, int entry_no, double value);
 int imcdf_add_global_attr_tt2000 (int cdf_handle, char *name, int entry_no, long long value);
@@ -171,24 +532,75 @@ int imcdf_add_variable_attr_double (int cdf_handle, char *attr_name,
 								    char *var_name, double value);
 int imcdf_add_variable_attr_tt2000 (int cdf_handle, char *attr_name, 
 								    char *var_name, long long value);
+void imcdf_init_var_options (struct IMCDFVarOptions *options);
 int imcdf_create_data_array (int cdf_handle, char *name, double *data,
                              int data_length);
 int imcdf_create_time_stamp_array (int cdf_handle, char *name, long long *data,
                                    int data_length);
+int imcdf_create_data_array_opt (int cdf_handle, char *name, double *data,
+                                 int data_length, struct IMCDFVarOptions *options);
+int imcdf_create_time_stamp_array_opt (int cdf_handle, char *name, long long *data,
+                                       int data_length, struct IMCDFVarOptions *options);
 int imcdf_append_data_array (int cdf_handle, char *name, double *data,
                              int data_length);
 int imcdf_append_time_stamp_array (int cdf_handle, char *name, long long *data,
                            int data_length);                             
+int imcdf_stream_start (int cdf_handle, int flush_records, int flush_seconds);
+int imcdf_stream_append_data (int cdf_handle, char *name, double *data,
+                              int data_length);
+int imcdf_stream_append_time_stamps (int cdf_handle, char *name, long long *data,
+                                     int data_length);
+int imcdf_stream_flush (int cdf_handle);
+int imcdf_stream_expect_records (int cdf_handle, char *name, int n_records);
 int imcdf_get_global_attribute_string (int cdf_handle, char *name, int entry_no, char **value);
+int imcdf_get_global_attribute_string_arena (int cdf_handle, char *name, int entry_no, 
+                                             struct IMCDFArena *arena, char **value);
 int imcdf_get_global_attribute_double (int cdf_handle, char *name, int entry_no, double *value);
 int imcdf_get_global_attribute_tt2000 (int cdf_handle, char *name, int entry_no, long long *value);
+int imcdf_get_n_attributes (int cdf_handle, int *n_attrs);
+int imcdf_get_attribute_info (int cdf_handle, int attr_num, char *name, int name_len,
+                              int *is_global, int *n_entries);
+int imcdf_get_global_entry_info (int cdf_handle, int attr_num, int entry_no,
+                                 long *data_type, int *n_elements, int *n_bytes);
+int imcdf_get_global_entry (int cdf_handle, int attr_num, int entry_no, void *value);
 int imcdf_get_variable_attribute_string (int cdf_handle, char *attr_name, 
                                          char *var_name, char **value);
+int imcdf_get_variable_attribute_string_arena (int cdf_handle, char *attr_name, 
+                                               char *var_name, struct IMCDFArena *arena,
+                                               char **value);
 int imcdf_get_variable_attribute_double (int cdf_handle, char *attr_name, 
                                          char *var_name, double *value);
+int imcdf_get_global_attribute_string_into (int cdf_handle, char *name, int entry_no, 
+                                            char *value, int capacity, int *length);
+int imcdf_get_variable_attribute_string_into (int cdf_handle, char *attr_name, 
+                                              char *var_name, char *value,
+                                              int capacity, int *length);
 double *imcdf_get_var_data (int cdf_handle, char *name, int *data_len);
 long long *imcdf_get_var_time_stamps (int cdf_handle, char *name, int *data_len);
+double *imcdf_get_var_data_arena (int cdf_handle, char *name, struct IMCDFArena *arena,
+                                  int *data_len);
+long long *imcdf_get_var_time_stamps_arena (int cdf_handle, char *name, struct IMCDFArena *arena,
+                                            int *data_len);
+double *imcdf_get_var_data_range (int cdf_handle, char *name, int first_rec, int n_recs);
+long long *imcdf_get_var_time_stamps_range (int cdf_handle, char *name, int first_rec, int n_recs);
+int imcdf_get_var_data_into (int cdf_handle, char *name, double *data,
+                             int capacity, int *data_len);
+int imcdf_get_var_time_stamps_into (int cdf_handle, char *name, long long *data,
+                                    int capacity, int *data_len);
+int imcdf_get_var_data_range_into (int cdf_handle, char *name, int first_rec, 
+                                   int n_recs, double *data);
+int imcdf_get_var_time_stamps_range_into (int cdf_handle, char *name, int first_rec, 
+                                          int n_recs, long long *data);
+int imcdf_find_time_stamp_range (int cdf_handle, char *name, 
+                                 long long start_tt2000, long long end_tt2000,
+                                 int *first_rec, int *n_recs);
 int imcdf_is_var_exist (int cdf_handle, char *name);
+int imcdf_get_var_compression (int cdf_handle, char *name, 
+                               enum IMCDFCompressionType *compress_type);
+int imcdf_get_n_vars (int cdf_handle, int *n_vars);
+int imcdf_get_var_info (int cdf_handle, int var_num, char *name, int name_len,
+                        long *data_type, int *n_recs, char *depend_0, int depend_0_len,
+                        enum IMCDFCompressionType *compress_type);
 int imcdf_date_time_to_tt2000 (int year, int month, int day, int hour, 
                                int min, int sec, long long *tt2000);
 int imcdf_tt2000_to_date_time (long long tt2000, 
@@ -198,9 +610,37 @@ long long imcdf_tt2000_inc (long long tt2000, int inc);
 long long *imcdf_make_tt2000_array (int year, int month, int day, int hour, int min, int sec,
                                     int increment, int n_samples);
 char *imcdf_tt2000_tostring (long long tt2000);
+char *imcdf_tt2000_tostring_r (long long tt2000, char *buffer);
+int imcdf_tt2000_to_date_time_array (long long *tt2000_array, int n_samples,
+                                     struct IMCDFDateTime *date_times);
+int imcdf_tt2000_to_string_array (long long *tt2000_array, int n_samples,
+                                  char *strings);
 int imcdf_calc_samp_per_from_tt2000 (long long *tt2000_array);
+void imcdf_arena_init (struct IMCDFArena *arena, size_t block_size);
+void *imcdf_arena_alloc (struct IMCDFArena *arena, size_t size);
+void imcdf_arena_reset (struct IMCDFArena *arena);
+void imcdf_arena_free (struct IMCDFArena *arena);
 CDFstatus imcdf_get_last_status_code ();
 char *imcdf_status_code_tostring (CDFstatus status);
+char *imcdf_status_code_tostring_r (CDFstatus status, char *message);
+/* imcdf_iaga2002.c */
+char *imcdf_export_iaga2002 (int cdf_handle, long long start_tt2000, long long end_tt2000,
+                             int write_header, struct IMCDFTextWriter *writer);
+char *imcdf_export_iaga2002_files (char **filenames, int n_files, 
+                                   long long start_tt2000, long long end_tt2000,
+                                   struct IMCDFTextWriter *writer);
+/* imcdf_import.c */
+char *imcdf_read_import_file (char *filename, struct IMCDFImportData *data);
+char *imcdf_read_iaga2002 (char *filename, struct IMCDFImportData *data);
+char *imcdf_read_imf (char *filename, struct IMCDFImportData *data);
+char *imcdf_write_import (int cdf_handle, struct IMCDFImportData *data);
+void imcdf_free_import (struct IMCDFImportData *data);
+char *imcdf_import_file (char *in_filename, char *out_dir,
+                         enum IMCDFCompressionType compress_type, char *out_filename);
+char *imcdf_import_directory (char *in_dir, char *out_dir,
+                              enum IMCDFCompressionType compress_type, int n_threads,
+                              FILE *log, int *n_converted, int *n_failed);
+int imcdf_parse_number (char **ptr, char *end, double *value);
 /* imcdf_utils.c */
 enum IMCDFPubLevel imcdf_parse_pub_level_string (char *string);
 char *imcdf_pub_level_code_tostring (enum IMCDFPubLevel code);
@@ -212,5 +652,13 @@ char *imcdf_get_var_name (enum IMCDFVariableType code, char element_code, char *
 enum IMCDFPubLevel imcdf_dt_to_pub_level (char *dt);
 void imcdf_print_global_attrs (struct IMCDFGlobalAttr *global_attrs);
 void imcdf_print_variable (struct IMCDFVariable *variable, struct IMCDFVariableTS *time_stamps);
+void imcdf_text_writer_init (struct IMCDFTextWriter *writer, FILE *file, int fd);
+int imcdf_text_write (struct IMCDFTextWriter *writer, const char *text, int length);
+int imcdf_text_write_number (struct IMCDFTextWriter *writer, double value, int decimals);
+int imcdf_text_writer_flush (struct IMCDFTextWriter *writer);
+int imcdf_format_fixed (double value, int decimals, char *buffer);
+int imcdf_write_variables_text (struct IMCDFTextWriter *writer, 
+                                struct IMCDFVariable **variables, int n_variables,
+                                struct IMCDFVariableTS *time_stamps, int decimals);
 
 
@@ -0,0 +1,306 @@
+/* benchmark the IMAG CDF routines with each type of compression, using
+ * synthetic data that looks like a real observatory record: slowly varying
+ * signals with noise, gaps filled with the missing data value and a
+ * temperature channel
+ *
+ * Usage: imcdf_bench [-a] [-d directory]
+ *        -a - include a year of second data (over 30 million records per
+ *             variable, which needs around 1 GB of memory and a long time)
+ *        -d - directory for the benchmark files (default: current directory)
+ *
+ * One line of comma separated values is written to stdout for each case:
+ *     cadence,coverage,compression,n_records,write_s,read_s,range_read_s,file_bytes
+ * where the times are wall clock seconds spent in the library to write the
+ * file, read all the variables and time stamps, and read one hour from the
+ * middle of each variable and its time stamps */
+
+#include <time.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "imcdf.h"
+
+#define N_VARS 5
+
+/* the cases to run - cadence in seconds and coverage in days */
+struct BenchCadence { char *name; int samp_per; };
+struct BenchCoverage { char *name; int n_days; };
+static struct BenchCadence cadences [] = { {"second", 1}, {"minute", 60} };
+static struct BenchCoverage coverages [] = { {"day", 1}, {"month", 31}, {"year", 365} };
+static char *compress_names [] = { "none", "rle", "huff", "ahuff",
+                                   "gzip1", "gzip2", "gzip3", "gzip4", "gzip5",
+                                   "gzip6", "gzip7", "gzip8", "gzip9",
+                                   "inherit", "auto" };
+
+static char cdf_filename [300] = "";
+
+void handle_error (char *err_msg);
+double elapsed (struct timespec *start);
+void make_data (double *data, int n_samples, int samp_per, int var_no);
+double uniform (unsigned long *seed);
+double noise (unsigned long *seed);
+void make_variable (struct IMCDFVariable *variable, int var_no, char *field_name);
+
+
+int main (int argc, char **argv)
+
+{
+  int count, cad, cov, comp, var_no, n_samples, all_cases;
+  char *dir, field_name [40];
+  double *data, write_s, read_s, range_s;
+  long long range_start, range_end;
+  struct timespec start;
+  struct stat stat_buf;
+  struct IMCDFGlobalAttr global_attrs;
+  struct IMCDFVariable variable, var;
+  struct IMCDFVariableTS time_stamps, ts;
+  struct IMCDFVarOptions options;
+  int cdf_handle;
+
+  all_cases = false;
+  dir = ".";
+  for (count=1; count<argc; count++)
+  {
+    if (! strcmp (argv [count], "-a")) all_cases = true;
+    else if (! strcmp (argv [count], "-d") && count +1 < argc) dir = argv [++ count];
+    else
+    {
+      fprintf (stderr, "Usage: %s [-a] [-d directory]\n", argv [0]);
+      exit (1);
+    }
+  }
+
+  /* create fake global attributes */
+  global_attrs.format_description = "";
+  global_attrs.format_version = "";
+  global_attrs.title = "";
+  global_attrs.iaga_code = "AFO";
+  global_attrs.elements_recorded = "HDZS";
+  global_attrs.pub_level = IMCDF_PUBLEVEL_1;
+  imcdf_date_time_to_tt2000 (2000, 1, 1, 0, 0, 0, &global_attrs.pub_date);
+  global_attrs.observatory_name = "A Fake Observatory";
+  global_attrs.latitude = 0.0;
+  global_attrs.longitude = 0.0;
+  global_attrs.elevation = 0.0;
+  global_attrs.institution = "INTERMANGET";
+  global_attrs.vector_sens_orient = "ABC";
+  global_attrs.standard_level = IMCDF_STANDLEVEL_NONE;
+  global_attrs.standard_name = 0;
+  global_attrs.standard_version = 0;
+  global_attrs.partial_stand_desc = 0;
+  global_attrs.source = "INTERMAGNET";
+  global_attrs.terms_of_use = "";
+  global_attrs.unique_identifier = 0;
+  global_attrs.parent_identifiers = 0;
+  global_attrs.n_parent_identifiers = 0;
+  global_attrs.reference_links = 0;
+  global_attrs.n_reference_links = 0;
+
+  printf ("cadence,coverage,compression,n_records,write_s,read_s,range_read_s,file_bytes\n");
+  for (cad=0; cad<(int) (sizeof (cadences) / sizeof (cadences [0])); cad++)
+  {
+    for (cov=0; cov<(int) (sizeof (coverages) / sizeof (coverages [0])); cov++)
+    {
+      if (cadences[cad].samp_per == 1 && coverages[cov].n_days > 31 && ! all_cases) continue;
+      n_samples = (coverages[cov].n_days * 86400) / cadences[cad].samp_per;
+
+      /* the time stamps are the same for every type of compression */
+      time_stamps.time_stamps = imcdf_make_tt2000_array (2015, 1, 1, 0, 0, 0, cadences[cad].samp_per, n_samples);
+      if (! time_stamps.time_stamps) handle_error ("Unable to allocate memory for time stamps");
+      time_stamps.data_len = n_samples;
+      time_stamps.var_name = DATA_TIMES_VAR_NAME;
+      range_start = time_stamps.time_stamps [n_samples / 2];
+      range_end = imcdf_tt2000_inc (range_start, 3599);
+      data = malloc (sizeof (double) * n_samples);
+      if (! data) handle_error ("Unable to allocate memory for data");
+
+      for (comp=IMCDF_COMPRESS_NONE; comp<=IMCDF_COMPRESS_AUTO; comp++)
+      {
+        /* inherit is the same as no compression when compression isn't set for the file */
+        if (comp == IMCDF_COMPRESS_INHERIT) continue;
+        imcdf_init_var_options (&options);
+        options.compress_type = (enum IMCDFCompressionType) comp;
+        sprintf (cdf_filename, "%s/bench_%s_%s_%s.cdf", dir, cadences[cad].name,
+                 coverages[cov].name, compress_names [comp]);
+
+        /* write the file - the data is generated one variable at a time to
+         * limit memory use, and only time spent in the library is counted */
+        write_s = 0.0;
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        handle_error (imcdf_open2 (cdf_filename, IMCDF_FORCE_CREATE, IMCDF_COMPRESS_NONE, &cdf_handle));
+        handle_error (imcdf_write_global_attrs (cdf_handle, &global_attrs));
+        write_s += elapsed (&start);
+        for (var_no=0; var_no<N_VARS; var_no++)
+        {
+          make_data (data, n_samples, cadences[cad].samp_per, var_no);
+          make_variable (&variable, var_no, field_name);
+          variable.data = data;
+          variable.data_len = n_samples;
+          clock_gettime (CLOCK_MONOTONIC, &start);
+          handle_error (imcdf_write_variable_opt (cdf_handle, &variable, true, &options));
+          write_s += elapsed (&start);
+        }
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        handle_error (imcdf_write_time_stamps_opt (cdf_handle, &time_stamps, &options));
+        handle_error (imcdf_close2 (cdf_handle));
+        write_s += elapsed (&start);
+
+        /* read everything */
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        handle_error (imcdf_open2 (cdf_filename, IMCDF_OPEN, IMCDF_COMPRESS_NONE, &cdf_handle));
+        for (var_no=0; var_no<N_VARS; var_no++)
+        {
+          make_variable (&variable, var_no, field_name);
+          handle_error (imcdf_read_variable (cdf_handle, variable.var_type, variable.elem_rec, &var));
+          imcdf_free_variable (&var);
+        }
+        handle_error (imcdf_read_time_stamps (cdf_handle, DATA_TIMES_VAR_NAME, &ts));
+        imcdf_free_time_stamps (&ts);
+        handle_error (imcdf_close2 (cdf_handle));
+        read_s = elapsed (&start);
+
+        /* read an hour from the middle of the file */
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        handle_error (imcdf_open2 (cdf_filename, IMCDF_OPEN, IMCDF_COMPRESS_NONE, &cdf_handle));
+        for (var_no=0; var_no<N_VARS; var_no++)
+        {
+          make_variable (&variable, var_no, field_name);
+          handle_error (imcdf_read_variable_range (cdf_handle, variable.var_type, variable.elem_rec,
+                                                   range_start, range_end, &var));
+          imcdf_free_variable (&var);
+        }
+        handle_error (imcdf_read_time_stamps_range (cdf_handle, DATA_TIMES_VAR_NAME,
+                                                    range_start, range_end, &ts));
+        imcdf_free_time_stamps (&ts);
+        handle_error (imcdf_close2 (cdf_handle));
+        range_s = elapsed (&start);
+
+        if (stat (cdf_filename, &stat_buf)) handle_error ("Unable to find size of file");
+        printf ("%s,%s,%s,%d,%.6f,%.6f,%.6f,%ld\n", cadences[cad].name, coverages[cov].name,
+                compress_names [comp], n_samples, write_s, read_s, range_s, (long) stat_buf.st_size);
+        fflush (stdout);
+        remove (cdf_filename);
+      }
+
+      free (data);
+      free (time_stamps.time_stamps);
+    }
+  }
+
+  exit (0);
+
+}
+
+
+void handle_error (char *err_msg)
+{
+  if (err_msg)
+  {
+    fprintf (stderr, "Error with CDF file [%s]: %s\n", cdf_filename, err_msg);
+    exit (1);
+  }
+}
+
+/* seconds since start */
+double elapsed (struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (double) (now.tv_sec - start->tv_sec) + ((double) (now.tv_nsec - start->tv_nsec) / 1.0e9);
+}
+
+/* create a fake data signal: a daily variation and a faster variation, plus
+ * noise, plus gaps where the data is missing - the same variable number
+ * always gives the same data */
+void make_data (double *data, int n_samples, int samp_per, int var_no)
+{
+  int count, gap_left;
+  unsigned long seed;
+  double amp_scale, amp_offest, noise_scale, t;
+
+  switch (var_no)
+  {
+  case 0:  amp_scale = 10.0; amp_offest = 20000.0; noise_scale = 0.1; break;
+  case 1:  amp_scale =  1.0; amp_offest =   -20.0; noise_scale = 0.01; break;
+  case 2:  amp_scale = 20.0; amp_offest = 30000.0; noise_scale = 0.1; break;
+  case 3:  amp_scale = 35.0; amp_offest = 50000.0; noise_scale = 0.1; break;
+  default: amp_scale =  2.0; amp_offest =    20.0; noise_scale = 0.05; break;
+  }
+
+  seed = 12345ul + (unsigned long) var_no;
+  gap_left = 0;
+  for (count=0; count<n_samples; count++)
+  {
+    /* gaps start on average once every 5000 samples and last up to an hour */
+    if (gap_left <= 0 && uniform (&seed) < 0.0002)
+      gap_left = 1 + (int) (uniform (&seed) * 3600.0) / samp_per;
+    if (gap_left > 0)
+    {
+      data [count] = IMCDF_MISSING_DATA_VALUE;
+      gap_left --;
+      continue;
+    }
+    t = (double) count * (double) samp_per;
+    data [count] = amp_offest
+                 + (amp_scale * sin (t * M_PI * 2.0 / 86400.0))
+                 + (amp_scale * 0.1 * sin (t * M_PI * 2.0 * (var_no + 1) / 3600.0))
+                 + (noise_scale * noise (&seed));
+    /* values are recorded to a fixed resolution */
+    data [count] = floor (data [count] * 100.0 + 0.5) / 100.0;
+  }
+}
+
+/* a random number between 0 and 1, from a simple generator so that the 
+ * data is the same on every platform */
+double uniform (unsigned long *seed)
+{
+  *seed = (*seed * 1103515245ul + 12345ul) & 0x7ffffffful;
+  return (double) *seed / 2147483648.0;
+}
+
+/* approximately normally distributed noise (mean 0, standard deviation 1) */
+double noise (unsigned long *seed)
+{
+  int count;
+  double sum;
+
+  sum = 0.0;
+  for (count=0; count<12; count++)
+    sum += uniform (seed);
+  return sum - 6.0;
+}
+
+/* fill in the metadata for a variable */
+void make_variable (struct IMCDFVariable *variable, int var_no, char *field_name)
+{
+  char *elements = "HDZS";
+
+  if (var_no < 4)
+  {
+    variable->var_type = IMCDF_VARTYPE_GEOMAGNETIC_FIELD_ELEMENT;
+    sprintf (field_name, "Geomagnetic Field Element %c", elements [var_no]);
+    variable->valid_min = var_no == 1 ? -360.0 : -80000.0;
+    variable->valid_max = var_no == 1 ?  360.0 :  80000.0;
+    variable->units = var_no == 1 ? "Degrees of arc" : "nT";
+    variable->elem_rec[0] = elements [var_no];
+    variable->elem_rec[1] = '\0';
+  }
+  else
+  {
+    variable->var_type = IMCDF_VARTYPE_TEMPERATURE;
+    sprintf (field_name, "Temperature %d", var_no -3);
+    variable->valid_min = -100.0;
+    variable->valid_max = 100.0;
+    variable->units = "Celcius";
+    variable->elem_rec[0] = (char) ('0' + var_no -3);
+    variable->elem_rec[1] = '\0';
+  }
+  variable->field_nam = field_name;
+  variable->fill_val = IMCDF_MISSING_DATA_VALUE;
+  variable->depend_0 = DATA_TIMES_VAR_NAME;
+}
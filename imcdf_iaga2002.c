@@ -0,0 +1,415 @@
+/*****************************************************************************
+ * imcdf_iaga2002.c - export of ImagCDF data to IAGA-2002 format text
+ *
+ * THE IMCDF ROUTINES SHOULD NOT HAVE DEPENDENCIES ON OTHER LIBRARY ROUTINES -
+ * IT MUST BE POSSIBLE TO DISTRIBUTE THE IMCDF SOURCE CODE
+ *
+ * IAGA-2002 files have four data columns - the first four geomagnetic
+ * elements named in the ElementsRecorded attribute are exported (a scalar
+ * element 'S' is given the IAGA-2002 code 'F'). The rows of the file follow
+ * the time stamps of the first element - other elements are matched to these
+ * time stamps and shown as missing where they have no sample. Data is read
+ * through the record iterators a window at a time, so files of any length
+ * are exported in a fixed amount of memory.
+ *****************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <ctype.h>
+
+#include "imcdf.h"
+
+/* the number of data columns in an IAGA-2002 file */
+#define IAGA2002_N_COLUMNS          4
+
+/* the number of records read from the CDF file at a time */
+#define IAGA2002_WINDOW_SIZE        1024
+
+/* the length of a line in an IAGA-2002 file, not including the newline */
+#define IAGA2002_LINE_LEN           70
+
+/* a data column being exported */
+struct ExportColumn
+{
+    char element [2];                   /* the ImagCDF element code */
+    int recorded;                       /* 0 if the element isn't in the file */
+    struct IMCDFRecordIterator iter;
+    int index;                          /* the position in the current window */
+};
+
+/* private forward declarations */
+static char *write_iaga2002_header (struct IMCDFGlobalAttr *global_attrs, struct ExportColumn *columns,
+                                   struct IMCDFRecordIterator *master, struct IMCDFTextWriter *writer);
+static int write_header_line (struct IMCDFTextWriter *writer, char *label, char *value);
+static char iaga2002_element (char element);
+static int write_comment (struct IMCDFTextWriter *writer, char *comment);
+static char *find_value (struct ExportColumn *column, long long tt2000, double *value);
+static double export_value (struct IMCDFVariable *variable, double value);
+static void format_data_line (struct IMCDFDateTime *date_time, double *values, char *line);
+static int day_of_year (int year, int month, int day);
+static void put_digits (char *buffer, int value, int n_digits);
+static void close_columns (struct ExportColumn *columns);
+
+/*****************************************************************************
+ * imcdf_export_iaga2002
+ *
+ * Description: write the geomagnetic data in an ImagCDF file as IAGA-2002
+ *              format text
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   start_tt2000 - the start of the time range to export (inclusive),
+ *                                  IMCDF_TT2000_EARLIEST to export from the start
+ *                                  of the file
+ *                   end_tt2000 - the end of the time range to export (inclusive),
+ *                                IMCDF_TT2000_LATEST to export to the end
+ *                                of the file
+ *                   write_header - 1 to write the IAGA-2002 header, 0 to write
+ *                                  the data only (for example when appending
+ *                                  the next file in a series)
+ *                   writer - the writer to send the text to - the caller must
+ *                            call imcdf_text_writer_flush () when done
+ * Output parameters: none
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_export_iaga2002 (int cdf_handle, long long start_tt2000, long long end_tt2000,
+                             int write_header, struct IMCDFTextWriter *writer)
+{
+    int count, row;
+    double values [IAGA2002_N_COLUMNS];
+    char *err_msg, line [IAGA2002_LINE_LEN +2];
+    struct IMCDFGlobalAttr global_attrs;
+    struct ExportColumn columns [IAGA2002_N_COLUMNS];
+    struct IMCDFRecordIterator *master;
+    struct IMCDFDateTime date_times [IAGA2002_WINDOW_SIZE];
+
+    err_msg = imcdf_read_global_attrs (cdf_handle, &global_attrs);
+    if (err_msg) return err_msg;
+
+    /* open an iterator for each element */
+    memset (columns, 0, sizeof (columns));
+    for (count=0; count<IAGA2002_N_COLUMNS; count++)
+    {
+        if (count < (int) strlen (global_attrs.elements_recorded))
+        {
+            columns[count].element [0] = global_attrs.elements_recorded [count];
+            err_msg = imcdf_iter_open_range (cdf_handle, IMCDF_VARTYPE_GEOMAGNETIC_FIELD_ELEMENT,
+                                             columns[count].element, IAGA2002_WINDOW_SIZE,
+                                             start_tt2000, end_tt2000, &(columns[count].iter));
+            if (err_msg)
+            {
+                close_columns (columns);
+                imcdf_free_global_attrs (&global_attrs);
+                return err_msg;
+            }
+            columns[count].recorded = 1;
+        }
+    }
+    if (! columns[0].recorded)
+    {
+        imcdf_free_global_attrs (&global_attrs);
+        return imcdf_format_error (IMCDF_ERROR_INVALID_FORMAT, "No geomagnetic elements recorded", 0, CDF_OK);
+    }
+
+    /* read the first window of the first element, which sets the rows of the file */
+    master = &(columns[0].iter);
+    err_msg = imcdf_iter_next (master);
+    if (! err_msg && write_header)
+        err_msg = write_iaga2002_header (&global_attrs, columns, master, writer);
+    imcdf_free_global_attrs (&global_attrs);
+
+    while (! err_msg && master->ts.data_len > 0)
+    {
+        imcdf_tt2000_to_date_time_array (master->ts.time_stamps, master->ts.data_len, date_times);
+        for (row=0; row<master->ts.data_len && ! err_msg; row++)
+        {
+            values [0] = export_value (&(master->variable), *(master->variable.data + row));
+            for (count=1; count<IAGA2002_N_COLUMNS && ! err_msg; count++)
+            {
+                if (columns[count].recorded)
+                    err_msg = find_value (columns + count, *(master->ts.time_stamps + row), values + count);
+                else
+                    values [count] = IMCDF_NOT_RECORDED_VALUE;
+            }
+            if (err_msg) break;
+            format_data_line (date_times + row, values, line);
+            if (imcdf_text_write (writer, line, IAGA2002_LINE_LEN +1))
+                err_msg = imcdf_format_error (IMCDF_ERROR_WRITE, "Error writing IAGA-2002 data", 0, CDF_OK);
+        }
+        if (! err_msg) err_msg = imcdf_iter_next (master);
+    }
+
+    close_columns (columns);
+    return err_msg;
+}
+
+/*****************************************************************************
+ * imcdf_export_iaga2002_files
+ *
+ * Description: write the geomagnetic data in a series of ImagCDF files as a
+ *              single IAGA-2002 file - the header is taken from the first
+ *              file
+ *
+ * Input parameters: filenames - the ImagCDF files, in time order
+ *                   n_files - the number of files
+ *                   start_tt2000, end_tt2000 - the time range to export, see
+ *                                              imcdf_export_iaga2002 ()
+ *                   writer - the writer to send the text to - the caller must
+ *                            call imcdf_text_writer_flush () when done
+ * Output parameters: none
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_export_iaga2002_files (char **filenames, int n_files,
+                                   long long start_tt2000, long long end_tt2000,
+                                   struct IMCDFTextWriter *writer)
+{
+    int count, cdf_handle;
+    char *err_msg;
+
+    for (count=0; count<n_files; count++)
+    {
+        err_msg = imcdf_open2 (*(filenames + count), IMCDF_OPEN, IMCDF_COMPRESS_NONE, &cdf_handle);
+        if (err_msg) return err_msg;
+        err_msg = imcdf_export_iaga2002 (cdf_handle, start_tt2000, end_tt2000, count == 0, writer);
+        if (err_msg)
+        {
+            imcdf_close2 (cdf_handle);
+            return err_msg;
+        }
+        err_msg = imcdf_close2 (cdf_handle);
+        if (err_msg) return err_msg;
+    }
+    return 0;
+}
+
+/** ------------------------------------------------------------------------
+ *  --------------------------- Private code below -------------------------
+ *  ------------------------------------------------------------------------*/
+
+/* write the IAGA-2002 header */
+static char *write_iaga2002_header (struct IMCDFGlobalAttr *global_attrs, struct ExportColumn *columns,
+                                   struct IMCDFRecordIterator *master, struct IMCDFTextWriter *writer)
+{
+    int count, interval, error;
+    char buffer [IAGA2002_LINE_LEN +2], name [IAGA2002_LINE_LEN], *ptr;
+
+    error = write_header_line (writer, "Format", "IAGA-2002");
+    error |= write_header_line (writer, "Source of Data", global_attrs->institution);
+    error |= write_header_line (writer, "Station Name", global_attrs->observatory_name);
+    error |= write_header_line (writer, "IAGA Code", global_attrs->iaga_code);
+    snprintf (buffer, sizeof (buffer), "%.3f", global_attrs->latitude);
+    error |= write_header_line (writer, "Geodetic Latitude", buffer);
+    snprintf (buffer, sizeof (buffer), "%.3f", global_attrs->longitude);
+    error |= write_header_line (writer, "Geodetic Longitude", buffer);
+    snprintf (buffer, sizeof (buffer), "%.0f", global_attrs->elevation);
+    error |= write_header_line (writer, "Elevation", buffer);
+    /* the elements reported are those in the columns, with their IAGA-2002 codes */
+    for (count=0; count<IAGA2002_N_COLUMNS && columns[count].recorded; count++)
+        buffer [count] = iaga2002_element (columns[count].element [0]);
+    buffer [count] = '\0';
+    error |= write_header_line (writer, "Reported", buffer);
+    error |= write_header_line (writer, "Sensor Orientation",
+                                global_attrs->vector_sens_orient ? global_attrs->vector_sens_orient : "");
+    error |= write_header_line (writer, "Digital Sampling", "");
+
+    /* the interval comes from the first two time stamps */
+    if (master->ts.data_len >= 2)
+    {
+        interval = imcdf_calc_samp_per_from_tt2000 (master->ts.time_stamps);
+        if (interval == 60) strcpy (buffer, "1-minute");
+        else snprintf (buffer, sizeof (buffer), "%d-second", interval);
+    }
+    else
+        strcpy (buffer, "");
+    error |= write_header_line (writer, "Data Interval Type", buffer);
+    switch (global_attrs->pub_level)
+    {
+    case IMCDF_PUBLEVEL_1: ptr = "Variation"; break;
+    case IMCDF_PUBLEVEL_2: ptr = "Provisional"; break;
+    case IMCDF_PUBLEVEL_3: ptr = "Quasi-definitive"; break;
+    case IMCDF_PUBLEVEL_4: ptr = "Definitive"; break;
+    default: ptr = ""; break;
+    }
+    error |= write_header_line (writer, "Data Type", ptr);
+
+    /* the terms of use become comments */
+    if (global_attrs->terms_of_use)
+        error |= write_comment (writer, global_attrs->terms_of_use);
+
+    /* the column headings - elements not in the file are shown with the
+     * IAGA code only */
+    ptr = buffer + sprintf (buffer, "DATE       TIME         DOY");
+    for (count=0; count<IAGA2002_N_COLUMNS; count++)
+    {
+        if (columns[count].recorded)
+            snprintf (name, sizeof (name), "%.3s%c", global_attrs->iaga_code,
+                      iaga2002_element (columns[count].element [0]));
+        else
+            snprintf (name, sizeof (name), "%.3s", global_attrs->iaga_code);
+        ptr += sprintf (ptr, count == 0 ? "%9.9s" : "%10.10s", name);
+    }
+    strcpy (ptr, "   |\n");
+    error |= imcdf_text_write (writer, buffer, -1);
+
+    if (error) return imcdf_format_error (IMCDF_ERROR_WRITE, "Error writing IAGA-2002 header", 0, CDF_OK);
+    return 0;
+}
+
+/* write a line of the header, truncating the value to fit */
+static int write_header_line (struct IMCDFTextWriter *writer, char *label, char *value)
+{
+    char line [IAGA2002_LINE_LEN +2];
+
+    snprintf (line, sizeof (line), " %-23.23s%-45.45s|\n", label, value ? value : "");
+    return imcdf_text_write (writer, line, IAGA2002_LINE_LEN +1);
+}
+
+/* the IAGA-2002 code for an ImagCDF element code - 'S' (scalar field
+ * from an independent instrument) is reported as 'F' */
+static char iaga2002_element (char element)
+{
+    return element == 'S' ? 'F' : element;
+}
+
+/* write a comment, splitting it into lines at newlines and, where it
+ * is too long to fit on one line, at the last space that fits */
+static int write_comment (struct IMCDFTextWriter *writer, char *comment)
+{
+    int length, error;
+    char line [IAGA2002_LINE_LEN +2];
+
+    error = 0;
+    while (*comment)
+    {
+        length = (int) strcspn (comment, "\n");
+        if (length > 66)
+        {
+            for (length=66; length>0 && comment [length] != ' '; length--);
+            if (length == 0) length = 66;
+        }
+        snprintf (line, sizeof (line), " # %-66.*s|\n", length, comment);
+        error |= imcdf_text_write (writer, line, IAGA2002_LINE_LEN +1);
+        comment += length;
+        if (*comment == '\n' || *comment == ' ') comment ++;
+    }
+    return error;
+}
+
+/* find the value of a column at a time - the column's time stamps are
+ * stepped through in order, so the times must be in ascending order */
+static char *find_value (struct ExportColumn *column, long long tt2000, double *value)
+{
+    char *err_msg;
+    struct IMCDFRecordIterator *iter;
+
+    iter = &(column->iter);
+    for (;;)
+    {
+        if (column->index >= iter->ts.data_len)
+        {
+            /* the window is used up - read the next one */
+            err_msg = imcdf_iter_next (iter);
+            if (err_msg) return err_msg;
+            column->index = 0;
+            if (iter->ts.data_len <= 0) break;
+        }
+        if (*(iter->ts.time_stamps + column->index) >= tt2000) break;
+        column->index ++;
+    }
+
+    if (column->index < iter->ts.data_len &&
+        *(iter->ts.time_stamps + column->index) == tt2000)
+        *value = export_value (&(iter->variable), *(iter->variable.data + column->index));
+    else
+        *value = IMCDF_MISSING_DATA_VALUE;
+    return 0;
+}
+
+/* convert a value to the value to export - fill values and values outside
+ * the valid range are shown as missing, angles are converted from degrees
+ * (ImagCDF) to minutes of arc (IAGA-2002) */
+static double export_value (struct IMCDFVariable *variable, double value)
+{
+    if (isnan (value) || value == variable->fill_val || value >= IMCDF_MISSING_DATA_VALUE)
+        return IMCDF_MISSING_DATA_VALUE;
+    if (variable->valid_min < variable->valid_max &&
+        (value < variable->valid_min || value > variable->valid_max))
+        return IMCDF_MISSING_DATA_VALUE;
+    switch (toupper (variable->elem_rec [0]))
+    {
+    case 'D':
+    case 'I':
+        return value * 60.0;
+    }
+    return value;
+}
+
+/* format a data line - the line must have space for IAGA2002_LINE_LEN +2
+ * characters, it is terminated with a newline and a null. Time stamps are
+ * written to the whole second */
+static void format_data_line (struct IMCDFDateTime *date_time, double *values, char *line)
+{
+    int count, length;
+    char number [IMCDF_NUMBER_STRING_LEN], *ptr;
+
+    put_digits (line, date_time->year, 4);
+    line [4] = '-';
+    put_digits (line + 5, date_time->month, 2);
+    line [7] = '-';
+    put_digits (line + 8, date_time->day, 2);
+    line [10] = ' ';
+    put_digits (line + 11, date_time->hour, 2);
+    line [13] = ':';
+    put_digits (line + 14, date_time->min, 2);
+    line [16] = ':';
+    put_digits (line + 17, date_time->sec, 2);
+    memcpy (line + 19, ".000 ", 5);
+    put_digits (line + 24, day_of_year (date_time->year, date_time->month, date_time->day), 3);
+    memcpy (line + 27, "   ", 3);
+
+    /* the values are right justified in 10 characters, as "%10.2f" */
+    ptr = line + 30;
+    for (count=0; count<IAGA2002_N_COLUMNS; count++)
+    {
+        length = imcdf_format_fixed (*(values + count), 2, number);
+        if (length > 10) length = 10;
+        memset (ptr, ' ', 10 - length);
+        memcpy (ptr + 10 - length, number, length);
+        ptr += 10;
+    }
+    *ptr ++ = '\n';
+    *ptr = '\0';
+}
+
+/* calculate the day of the year (from 1) */
+static int day_of_year (int year, int month, int day)
+{
+    static const int days_before_month [] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+    int doy;
+
+    doy = days_before_month [month -1] + day;
+    if (month > 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) doy ++;
+    return doy;
+}
+
+/* write a positive number as a fixed number of digits, with leading zeros */
+static void put_digits (char *buffer, int value, int n_digits)
+{
+    while (n_digits > 0)
+    {
+        buffer [-- n_digits] = (char) ('0' + (value % 10));
+        value /= 10;
+    }
+}
+
+/* close the iterators for all columns */
+static void close_columns (struct ExportColumn *columns)
+{
+    int count;
+
+    for (count=0; count<IAGA2002_N_COLUMNS; count++)
+    {
+        if (columns[count].recorded) imcdf_iter_close (&(columns[count].iter));
+    }
+}
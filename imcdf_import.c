@@ -0,0 +1,1029 @@
+/*****************************************************************************
+ * imcdf_import.c - import of IAGA-2002 and IMF (INTERMAGNET Minute Format)
+ *                  text files to ImagCDF
+ *
+ * THE IMCDF ROUTINES SHOULD NOT HAVE DEPENDENCIES ON OTHER LIBRARY ROUTINES -
+ * IT MUST BE POSSIBLE TO DISTRIBUTE THE IMCDF SOURCE CODE
+ *
+ * To convert a file: call imcdf_import_file ()
+ * To convert all the files in a directory tree: call imcdf_import_directory ()
+ * To read a file without writing it: call imcdf_read_import_file () (or
+ *        imcdf_read_iaga2002 () or imcdf_read_imf ()), then
+ *        imcdf_free_import () when done with the data
+ *
+ * Files are read into memory in one piece and parsed in place, without
+ * sscanf. Time stamps are calculated from the start of each day, so the
+ * calendar is only converted once per day. Element 'F' in the text formats
+ * is imported as an independent scalar ('S'), and angles are converted from
+ * minutes of arc to degrees.
+ *****************************************************************************/
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "imcdf.h"
+
+/* IMF files are made of hourly blocks of a header line and 30 lines of data,
+ * each data line holding 2 minutes of samples */
+#define IMF_LINES_PER_BLOCK         30
+#define IMF_MINUTES_PER_BLOCK       60
+
+/* the missing and not recorded values used in the text formats */
+#define IAGA2002_MISSING_VALUE      99999.0
+#define IAGA2002_NOT_RECORDED_VALUE 88888.0
+#define IMF_MISSING_VALUE           999999.0
+#define IMF_NOT_RECORDED_VALUE      888888.0
+
+/* a pointer into the text of a file */
+struct Tokenizer
+{
+    char *ptr;
+    char *end;
+};
+
+/* the start of the day used when calculating time stamps */
+struct DayCache
+{
+    int year, month, day;
+    long long start;
+};
+
+/* a list of files and the shared state of the threads converting them */
+struct ImportJob
+{
+    char **filenames;
+    int n_files;
+    int next_file;
+    char *out_dir;
+    enum IMCDFCompressionType compress_type;
+    int n_converted;
+    int n_failed;
+    FILE *log;
+    char **out_names;
+    int n_out_names;
+    int n_out_alloc;
+    pthread_mutex_t lock;
+};
+
+/* private forward declarations */
+static char *read_whole_file (char *filename, char **text, long *length);
+static char *next_line (struct Tokenizer *tokenizer, int *length);
+static int skip_spaces (char **ptr, char *end);
+static int parse_number (char **ptr, char *end, double *value);
+static int parse_digits (char *ptr, int n_digits);
+static char *trimmed_copy (char *start, int length, char **store);
+static int day_time_stamp (struct DayCache *cache, int year, int month, int day,
+                           int sec_of_day, long long *tt2000);
+static char *alloc_import (struct IMCDFImportData *data, int n_samples, int n_text);
+static void set_element (struct IMCDFImportData *data, int index, char element, char **store);
+static void finish_import (struct IMCDFImportData *data, int n_samples, char *store);
+static int file_format (char *filename);
+static int imf_month (char *ptr);
+static int collect_files (char *dir_name, char ***filenames, int *n_files, int *n_alloc);
+static char *import_file (char *in_filename, char *out_dir,
+                          enum IMCDFCompressionType compress_type, char *out_filename,
+                          struct ImportJob *job);
+static char *claim_out_filename (struct ImportJob *job, char *filename);
+static void *import_thread (void *arg);
+
+/*****************************************************************************
+ * imcdf_read_import_file
+ * imcdf_read_iaga2002
+ * imcdf_read_imf
+ *
+ * Description: read an IAGA-2002 or IMF file - imcdf_read_import_file ()
+ *              decides which format the file is in from its contents
+ *
+ * Input parameters: filename - the file to read
+ * Output parameters: data - the contents of the file, which must be freed
+ *                           with imcdf_free_import () after a successful call
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_read_import_file (char *filename, struct IMCDFImportData *data)
+{
+    switch (file_format (filename))
+    {
+    case IMCDF_IMPORT_IAGA2002: return imcdf_read_iaga2002 (filename, data);
+    case IMCDF_IMPORT_IMF:      return imcdf_read_imf (filename, data);
+    default: break;
+    }
+    return imcdf_format_error (IMCDF_ERROR_INVALID_FORMAT, "File is not IAGA-2002 or IMF", filename, CDF_OK);
+}
+
+
+char *imcdf_read_iaga2002 (char *filename, struct IMCDFImportData *data)
+{
+    int length, count, n_samples, n_columns, sec_of_day;
+    long text_length;
+    double value, values [IMCDF_IMPORT_MAX_ELEMENTS];
+    char *text, *line, *label, *value_ptr, *ptr, *store, *err_msg, *data_type;
+    char elements [IMCDF_IMPORT_MAX_ELEMENTS];
+    struct Tokenizer tokenizer;
+    struct DayCache day_cache;
+    struct IMCDFGlobalAttr *global_attrs;
+
+    err_msg = read_whole_file (filename, &text, &text_length);
+    if (err_msg) return err_msg;
+    tokenizer.ptr = text;
+    tokenizer.end = text + text_length;
+
+    /* find the column headings, which end the header - the number of lines
+     * after them sets the size of the data arrays */
+    while ((line = next_line (&tokenizer, &length)) != 0)
+    {
+        if (length >= 4 && ! strncmp (line, "DATE", 4)) break;
+    }
+    if (! line)
+    {
+        free (text);
+        return imcdf_format_error (IMCDF_ERROR_INVALID_FORMAT, "IAGA-2002 column headings not found", filename, CDF_OK);
+    }
+    for (n_samples=0, ptr=tokenizer.ptr; ptr<tokenizer.end; n_samples++)
+    {
+        ptr = memchr (ptr, '\n', tokenizer.end - ptr);
+        if (! ptr) ptr = tokenizer.end;
+        else ptr ++;
+    }
+    err_msg = alloc_import (data, n_samples, (int) (tokenizer.ptr - text));
+    if (err_msg)
+    {
+        free (text);
+        return err_msg;
+    }
+    store = data->strings;
+    global_attrs = &(data->global_attrs);
+
+    /* the element codes are the last character of each column heading */
+    ptr = line + 4;
+    n_columns = 0;
+    while (n_columns < IMCDF_IMPORT_MAX_ELEMENTS && skip_spaces (&ptr, line + length))
+    {
+        label = ptr;
+        while (ptr < line + length && ! isspace (*ptr) && *ptr != '|') ptr ++;
+        if (ptr - label >= 4 && strncmp (label, "TIME", 4) && strncmp (label, "DOY", 3))
+            elements [n_columns ++] = *(ptr -1);
+        if (ptr < line + length && *ptr == '|') break;
+    }
+
+    /* read the header */
+    data_type = "";
+    tokenizer.ptr = text;
+    while ((line = next_line (&tokenizer, &length)) != 0)
+    {
+        if (length >= 4 && ! strncmp (line, "DATE", 4)) break;
+        if (length < 25 || line [1] == '#') continue;
+        label = line + 1;
+        value_ptr = line + 24;
+        for (count = length; count > 24 && (line [count -1] == '|' || isspace (line [count -1])); count--);
+        length = count - 24;
+        if (! strncasecmp (label, "Source of Data", 14))
+            global_attrs->institution = trimmed_copy (value_ptr, length, &store);
+        else if (! strncasecmp (label, "Station Name", 12))
+            global_attrs->observatory_name = trimmed_copy (value_ptr, length, &store);
+        else if (! strncasecmp (label, "IAGA Code", 9))
+            global_attrs->iaga_code = trimmed_copy (value_ptr, length, &store);
+        else if (! strncasecmp (label, "Geodetic Latitude", 17))
+            parse_number (&value_ptr, value_ptr + length, &(global_attrs->latitude));
+        else if (! strncasecmp (label, "Geodetic Longitude", 18))
+            parse_number (&value_ptr, value_ptr + length, &(global_attrs->longitude));
+        else if (! strncasecmp (label, "Elevation", 9))
+            parse_number (&value_ptr, value_ptr + length, &(global_attrs->elevation));
+        else if (! strncasecmp (label, "Sensor Orientation", 18))
+            global_attrs->vector_sens_orient = trimmed_copy (value_ptr, length, &store);
+        else if (! strncasecmp (label, "Data Type", 9))
+            data_type = trimmed_copy (value_ptr, length, &store);
+    }
+    if (data_type && *data_type) global_attrs->pub_level = imcdf_dt_to_pub_level (data_type);
+
+    /* read the data - "YYYY-MM-DD HH:MM:SS.mmm DDD" then the values */
+    day_cache.year = -1;
+    n_samples = 0;
+    while ((line = next_line (&tokenizer, &length)) != 0)
+    {
+        if (length < 27) continue;
+        sec_of_day = (parse_digits (line + 11, 2) * 3600) + (parse_digits (line + 14, 2) * 60) +
+                     parse_digits (line + 17, 2);
+        if (day_time_stamp (&day_cache, parse_digits (line, 4), parse_digits (line + 5, 2),
+                            parse_digits (line + 8, 2), sec_of_day, data->ts.time_stamps + n_samples))
+        {
+            free (text);
+            imcdf_free_import (data);
+            return imcdf_format_error (IMCDF_ERROR_INVALID_FORMAT, "Invalid date in IAGA-2002 data", filename, CDF_OK);
+        }
+        *(data->ts.time_stamps + n_samples) += (long long) parse_digits (line + 20, 3) * 1000000ll;
+
+        ptr = line + 27;
+        for (count=0; count<n_columns; count++)
+        {
+            if (! parse_number (&ptr, line + length, &value)) value = IAGA2002_MISSING_VALUE;
+            values [count] = value;
+        }
+        for (count=0; count<n_columns; count++)
+        {
+            value = values [count];
+            if (value >= IAGA2002_NOT_RECORDED_VALUE) value = IMCDF_MISSING_DATA_VALUE;
+            else if (elements [count] == 'D' || elements [count] == 'I') value /= 60.0;
+            *(data->variables[count].data + n_samples) = value;
+            /* data_len is used to flag columns that have some data */
+            if (values [count] != IAGA2002_NOT_RECORDED_VALUE) data->variables[count].data_len = 1;
+        }
+        n_samples ++;
+    }
+
+    free (text);
+    for (count=0; count<n_columns; count++)
+        set_element (data, count, elements [count], &store);
+    data->n_variables = n_columns;
+    finish_import (data, n_samples, store);
+    return 0;
+}
+
+
+char *imcdf_read_imf (char *filename, struct IMCDFImportData *data)
+{
+    int length, count, n_blocks, n_samples, line_count, n_columns, hour, year, month, day;
+    int colat_long, minute;
+    long text_length;
+    double value;
+    char *text, *line, *ptr, *store, *err_msg, elements [IMCDF_IMPORT_MAX_ELEMENTS +1];
+    struct Tokenizer tokenizer;
+    struct DayCache day_cache;
+    struct IMCDFGlobalAttr *global_attrs;
+
+    err_msg = read_whole_file (filename, &text, &text_length);
+    if (err_msg) return err_msg;
+
+    /* count the non-blank lines to find the number of hourly blocks */
+    tokenizer.ptr = text;
+    tokenizer.end = text + text_length;
+    for (count=0; (line = next_line (&tokenizer, &length)) != 0; )
+    {
+        if (skip_spaces (&line, line + length)) count ++;
+    }
+    n_blocks = count / (IMF_LINES_PER_BLOCK +1);
+    err_msg = alloc_import (data, n_blocks * IMF_MINUTES_PER_BLOCK, 0);
+    if (err_msg)
+    {
+        free (text);
+        return err_msg;
+    }
+    store = data->strings;
+    global_attrs = &(data->global_attrs);
+
+    /* each block: "IIIbMMMDDYYbDDDbHHbCCCCbTbGINbCOLALONGbDECBASbRRRR..." then the data */
+    tokenizer.ptr = text;
+    day_cache.year = -1;
+    n_samples = n_columns = 0;
+    while ((line = next_line (&tokenizer, &length)) != 0)
+    {
+        ptr = line;
+        if (! skip_spaces (&ptr, line + length) || length < 39) continue;
+        month = imf_month (line + 4);
+        day = parse_digits (line + 7, 2);
+        year = parse_digits (line + 9, 2);
+        year += year >= 70 ? 1900 : 2000;
+        hour = parse_digits (line + 16, 2);
+        if (! month || hour < 0 || hour > 23)
+        {
+            free (text);
+            imcdf_free_import (data);
+            return imcdf_format_error (IMCDF_ERROR_INVALID_FORMAT, "Invalid IMF block header", filename, CDF_OK);
+        }
+        if (n_samples == 0)
+        {
+            /* the metadata comes from the first block */
+            global_attrs->iaga_code = trimmed_copy (line, 3, &store);
+            global_attrs->observatory_name = global_attrs->iaga_code;
+            for (n_columns=0; n_columns<IMCDF_IMPORT_MAX_ELEMENTS && isalpha (line [19 + n_columns]); n_columns++)
+                elements [n_columns] = (char) toupper (line [19 + n_columns]);
+            global_attrs->pub_level = imcdf_dt_to_pub_level (line + 24);
+            colat_long = parse_digits (line + 30, 4);
+            global_attrs->latitude = 90.0 - ((double) colat_long / 10.0);
+            global_attrs->longitude = (double) parse_digits (line + 34, 4) / 10.0;
+        }
+
+        /* the data lines each hold 2 minutes of samples */
+        for (line_count=0; line_count<IMF_LINES_PER_BLOCK; line_count++)
+        {
+            line = next_line (&tokenizer, &length);
+            if (! line) break;
+            ptr = line;
+            for (minute=0; minute<2; minute++)
+            {
+                if (n_samples >= data->ts.data_len) break;
+                if (day_time_stamp (&day_cache, year, month, day,
+                                    (hour * 3600) + (((line_count * 2) + minute) * 60),
+                                    data->ts.time_stamps + n_samples))
+                {
+                    free (text);
+                    imcdf_free_import (data);
+                    return imcdf_format_error (IMCDF_ERROR_INVALID_FORMAT, "Invalid date in IMF block header", filename, CDF_OK);
+                }
+                for (count=0; count<n_columns; count++)
+                {
+                    if (! parse_number (&ptr, line + length, &value)) value = IMF_MISSING_VALUE;
+                    if (value != IMF_NOT_RECORDED_VALUE) data->variables[count].data_len = 1;
+                    if (value >= IMF_MISSING_VALUE || value == IMF_NOT_RECORDED_VALUE)
+                        value = IMCDF_MISSING_DATA_VALUE;
+                    else if (elements [count] == 'D' || elements [count] == 'I')
+                        value /= 6000.0;
+                    else
+                        value /= 10.0;
+                    *(data->variables[count].data + n_samples) = value;
+                }
+                n_samples ++;
+            }
+        }
+    }
+
+    free (text);
+    for (count=0; count<n_columns; count++)
+        set_element (data, count, elements [count], &store);
+    data->n_variables = n_columns;
+    finish_import (data, n_samples, store);
+    return 0;
+}
+
+/*****************************************************************************
+ * imcdf_write_import
+ *
+ * Description: write data read from an IAGA-2002 or IMF file to an ImagCDF
+ *              file - the records of each variable are allocated before
+ *              they are written
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   data - the data to write
+ * Output parameters: none
+ * Returns: null for success, an error message if there was a fault
+ *
+ *****************************************************************************/
+char *imcdf_write_import (int cdf_handle, struct IMCDFImportData *data)
+{
+    int count, has_vector, has_scalar;
+    char *err_msg;
+    struct IMCDFVarOptions options;
+
+    err_msg = imcdf_write_global_attrs (cdf_handle, &(data->global_attrs));
+    if (err_msg) return err_msg;
+
+    has_vector = has_scalar = 0;
+    for (count=0; count<data->n_variables; count++)
+    {
+        imcdf_init_var_options (&options);
+        options.expected_records = data->variables[count].data_len;
+        err_msg = imcdf_write_variable_opt (cdf_handle, data->variables + count, 0, &options);
+        if (err_msg) return err_msg;
+        if (imcdf_is_scalar_gm_data (data->variables[count].var_type, data->variables[count].elem_rec))
+            has_scalar = 1;
+        else
+            has_vector = 1;
+    }
+
+    if (has_vector)
+    {
+        data->ts.var_name = VECTOR_TIME_STAMPS_VAR_NAME;
+        err_msg = imcdf_write_time_stamps (cdf_handle, &(data->ts));
+        if (err_msg) return err_msg;
+    }
+    if (has_scalar)
+    {
+        data->ts.var_name = SCALAR_TIME_STAMPS_VAR_NAME;
+        err_msg = imcdf_write_time_stamps (cdf_handle, &(data->ts));
+        if (err_msg) return err_msg;
+    }
+    return 0;
+}
+
+/*****************************************************************************
+ * imcdf_free_import
+ *
+ * Description: Free the memory allocated after a successful call to
+ *                imcdf_read_import_file (), imcdf_read_iaga2002 () or
+ *                imcdf_read_imf ()
+ *
+ * Input parameters: data - the data passed to the read routine
+ * Output parameters:
+ * Returns:
+ *
+ *****************************************************************************/
+void imcdf_free_import (struct IMCDFImportData *data)
+{
+    int count;
+
+    for (count=0; count<IMCDF_IMPORT_MAX_ELEMENTS; count++)
+        free (data->variables[count].data);
+    free (data->ts.time_stamps);
+    free (data->strings);
+}
+
+/*****************************************************************************
+ * imcdf_import_file
+ *
+ * Description: convert an IAGA-2002 or IMF file to an ImagCDF file - the
+ *              name of the ImagCDF file is made from the contents of the
+ *              file using imcdf_make_filename ()
+ *
+ * Input parameters: in_filename - the file to convert
+ *                   out_dir - the directory to write the ImagCDF file to,
+ *                             or null for the current directory
+ *                   compress_type - the compression for the ImagCDF file
+ * Output parameters: out_filename - if not null, the name of the ImagCDF
+ *                                   file - must be at least
+ *                                   IMCDF_FILENAME_LEN long
+ * Returns: null for success, an error message if there was a fault,
+ *          including an out_dir too long to make a file name from
+ *
+ *****************************************************************************/
+char *imcdf_import_file (char *in_filename, char *out_dir,
+                         enum IMCDFCompressionType compress_type, char *out_filename)
+{
+    return import_file (in_filename, out_dir, compress_type, out_filename, 0);
+}
+
+/*****************************************************************************
+ * imcdf_import_directory
+ *
+ * Description: convert all the IAGA-2002 and IMF files in a directory tree
+ *              to ImagCDF files, using a number of threads - files that
+ *              are in neither format are ignored. If more than one file
+ *              makes the same ImagCDF file name only the first to be
+ *              read is converted and the others are counted as failures
+ *
+ * Input parameters: in_dir - the directory to search
+ *                   out_dir - the directory to write the ImagCDF files to
+ *                   compress_type - the compression for the ImagCDF files
+ *                   n_threads - the number of files to convert at once
+ *                   log - if not null, a stream to which the name of each
+ *                         file that couldn't be converted is written,
+ *                         along with the reason
+ * Output parameters: n_converted - the number of files converted
+ *                    n_failed - the number of files that couldn't be converted
+ * Returns: null for success, an error message if there was a fault -
+ *          failing to convert individual files isn't an error
+ *
+ *****************************************************************************/
+char *imcdf_import_directory (char *in_dir, char *out_dir,
+                              enum IMCDFCompressionType compress_type, int n_threads,
+                              FILE *log, int *n_converted, int *n_failed)
+{
+    int count, n_alloc, n_started;
+    char *err_msg;
+    pthread_t *threads;
+    struct ImportJob job;
+
+    *n_converted = *n_failed = 0;
+    if (n_threads < 1) n_threads = 1;
+
+    memset (&job, 0, sizeof (job));
+    n_alloc = 0;
+    if (collect_files (in_dir, &(job.filenames), &(job.n_files), &n_alloc))
+    {
+        for (count=0; count<job.n_files; count++) free (*(job.filenames + count));
+        free (job.filenames);
+        return imcdf_format_error (IMCDF_ERROR_INVALID_ARGUMENT, "Unable to read directory", in_dir, CDF_OK);
+    }
+    job.out_dir = out_dir;
+    job.compress_type = compress_type;
+    job.log = log;
+    pthread_mutex_init (&(job.lock), 0);
+
+    /* run the threads - if a thread can't be started its share of the
+     * work is picked up by the others, or by this thread */
+    err_msg = 0;
+    threads = malloc (sizeof (pthread_t) * n_threads);
+    n_started = 0;
+    if (threads)
+    {
+        for (n_started=0; n_started<n_threads; n_started++)
+        {
+            if (pthread_create (threads + n_started, 0, import_thread, &job)) break;
+        }
+    }
+    if (n_started == 0) import_thread (&job);
+    for (count=0; count<n_started; count++)
+        pthread_join (*(threads + count), 0);
+
+    *n_converted = job.n_converted;
+    *n_failed = job.n_failed;
+    pthread_mutex_destroy (&(job.lock));
+    for (count=0; count<job.n_files; count++) free (*(job.filenames + count));
+    free (job.filenames);
+    for (count=0; count<job.n_out_names; count++) free (*(job.out_names + count));
+    free (job.out_names);
+    free (threads);
+    return err_msg;
+}
+
+/*****************************************************************************
+ * imcdf_parse_number
+ *
+ * Description: parse a number from a field of an IAGA-2002 or IMF file, in
+ *              the same way as the file readers do - leading spaces are
+ *              skipped and the number may have a sign and a fractional part
+ *
+ * Input parameters: ptr - the start of the text to parse
+ *                   end - the end of the text to parse
+ * Output parameters: ptr - moved past the number
+ *                    value - the number
+ * Returns: 1 if a number was found, 0 if there was no number, in which
+ *          case value is not set (ptr may have been moved past spaces)
+ *
+ *****************************************************************************/
+int imcdf_parse_number (char **ptr, char *end, double *value)
+{
+    return parse_number (ptr, end, value);
+}
+
+/** ------------------------------------------------------------------------
+ *  --------------------------- Private code below -------------------------
+ *  ------------------------------------------------------------------------*/
+
+/* read a file into memory - the text is null terminated */
+static char *read_whole_file (char *filename, char **text, long *length)
+{
+    FILE *fp;
+
+    fp = fopen (filename, "rb");
+    if (! fp) return imcdf_format_error (IMCDF_ERROR_INVALID_ARGUMENT, "Unable to open file", filename, CDF_OK);
+    if (fseek (fp, 0l, SEEK_END) || (*length = ftell (fp)) < 0l || fseek (fp, 0l, SEEK_SET))
+    {
+        fclose (fp);
+        return imcdf_format_error (IMCDF_ERROR_INVALID_ARGUMENT, "Unable to read file", filename, CDF_OK);
+    }
+    *text = malloc (*length +1);
+    if (! *text)
+    {
+        fclose (fp);
+        return imcdf_format_error (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", filename, CDF_OK);
+    }
+    if (fread (*text, 1, *length, fp) != (size_t) *length)
+    {
+        fclose (fp);
+        free (*text);
+        return imcdf_format_error (IMCDF_ERROR_INVALID_ARGUMENT, "Unable to read file", filename, CDF_OK);
+    }
+    fclose (fp);
+    *(*text + *length) = '\0';
+    return 0;
+}
+
+/* get the next line from the text, without its line terminator - returns
+ * null at the end of the text */
+static char *next_line (struct Tokenizer *tokenizer, int *length)
+{
+    char *line, *eol;
+
+    if (tokenizer->ptr >= tokenizer->end) return 0;
+    line = tokenizer->ptr;
+    eol = memchr (line, '\n', tokenizer->end - line);
+    if (eol) tokenizer->ptr = eol +1;
+    else tokenizer->ptr = eol = tokenizer->end;
+    if (eol > line && *(eol -1) == '\r') eol --;
+    *length = (int) (eol - line);
+    return line;
+}
+
+/* move past spaces - returns 0 if the end was reached */
+static int skip_spaces (char **ptr, char *end)
+{
+    while (*ptr < end && isspace (**ptr)) (*ptr) ++;
+    return *ptr < end;
+}
+
+/* parse a number that may have a sign and a fractional part - the number is
+ * accumulated as an integer and divided by a power of ten once, which gives
+ * the same result as strtod for the numbers found in these files. Returns 0
+ * if there was no number */
+static int parse_number (char **ptr, char *end, double *value)
+{
+    static const double powers [] = { 1.0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5, 1.0e6,
+                                      1.0e7, 1.0e8, 1.0e9, 1.0e10, 1.0e11, 1.0e12 };
+    int negative, n_decimals, n_digits;
+    long long mantissa;
+    char *p;
+
+    if (! skip_spaces (ptr, end)) return 0;
+    p = *ptr;
+    negative = 0;
+    if (*p == '-' || *p == '+')
+    {
+        negative = *p == '-';
+        p ++;
+    }
+    mantissa = 0;
+    n_decimals = n_digits = 0;
+    for (; p < end && isdigit (*p) && n_digits < 18; p++, n_digits++)
+        mantissa = (mantissa * 10) + (*p - '0');
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && isdigit (*p) && n_digits < 18 && n_decimals < 12; p++, n_digits++, n_decimals++)
+            mantissa = (mantissa * 10) + (*p - '0');
+    }
+    if (n_digits == 0) return 0;
+    /* ignore digits that are beyond the precision held */
+    while (p < end && (isdigit (*p) || *p == '.')) p ++;
+
+    *value = (double) mantissa / powers [n_decimals];
+    if (negative) *value = - *value;
+    *ptr = p;
+    return 1;
+}
+
+/* parse a fixed number of digits - non-digits count as 0 */
+static int parse_digits (char *ptr, int n_digits)
+{
+    int value;
+
+    for (value=0; n_digits > 0; n_digits--, ptr++)
+        value = (value * 10) + (isdigit (*ptr) ? *ptr - '0' : 0);
+    return value;
+}
+
+/* copy a string without leading and trailing spaces to the string store -
+ * returns null if the string is empty */
+static char *trimmed_copy (char *start, int length, char **store)
+{
+    char *copy;
+
+    while (length > 0 && isspace (*start)) { start ++; length --; }
+    while (length > 0 && isspace (*(start + length -1))) length --;
+    if (length <= 0) return 0;
+    copy = *store;
+    memcpy (copy, start, length);
+    *(copy + length) = '\0';
+    *store += length +1;
+    return copy;
+}
+
+/* calculate a time stamp, converting the calendar only when the day changes */
+static int day_time_stamp (struct DayCache *cache, int year, int month, int day,
+                           int sec_of_day, long long *tt2000)
+{
+    if (year != cache->year || month != cache->month || day != cache->day)
+    {
+        if (imcdf_date_time_to_tt2000 (year, month, day, 0, 0, 0, &(cache->start))) return -1;
+        cache->year = year;
+        cache->month = month;
+        cache->day = day;
+    }
+    *tt2000 = cache->start + ((long long) sec_of_day * 1000000000ll);
+    return 0;
+}
+
+/* allocate the space for the data and strings of an import - n_text is
+ * the length of the header that strings are copied from */
+static char *alloc_import (struct IMCDFImportData *data, int n_samples, int n_text)
+{
+    int count, failed;
+
+    memset (data, 0, sizeof (struct IMCDFImportData));
+    failed = 0;
+    /* the header, the field names and the units */
+    data->strings = malloc (n_text + (IMCDF_IMPORT_MAX_ELEMENTS * 60) + 10);
+    if (! data->strings) failed = 1;
+    data->ts.time_stamps = malloc (sizeof (long long) * (n_samples > 0 ? n_samples : 1));
+    if (! data->ts.time_stamps) failed = 1;
+    for (count=0; count<IMCDF_IMPORT_MAX_ELEMENTS; count++)
+    {
+        data->variables[count].data = malloc (sizeof (double) * (n_samples > 0 ? n_samples : 1));
+        if (! data->variables[count].data) failed = 1;
+    }
+    data->ts.data_len = n_samples;
+    data->global_attrs.pub_level = IMCDF_PUBLEVEL_1;
+    data->global_attrs.standard_level = IMCDF_STANDLEVEL_NONE;
+    data->global_attrs.source = "institute";
+    data->global_attrs.institution = "Unknown";
+    if (failed)
+    {
+        imcdf_free_import (data);
+        return imcdf_format_error (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", "import", CDF_OK);
+    }
+    return 0;
+}
+
+/* set up the metadata for a variable */
+static void set_element (struct IMCDFImportData *data, int index, char element, char **store)
+{
+    struct IMCDFVariable *variable;
+
+    variable = data->variables + index;
+    if (element == 'F') element = 'S';
+    variable->var_type = IMCDF_VARTYPE_GEOMAGNETIC_FIELD_ELEMENT;
+    variable->elem_rec [0] = element;
+    variable->elem_rec [1] = '\0';
+    variable->field_nam = *store;
+    *store += sprintf (*store, "Geomagnetic Field Element %c", element) +1;
+    variable->fill_val = IMCDF_MISSING_DATA_VALUE;
+    switch (element)
+    {
+    case 'D':
+    case 'I':
+        variable->units = "Degrees of arc";
+        variable->valid_min = -360.0;
+        variable->valid_max = 360.0;
+        break;
+    case 'S':
+    case 'G':
+        variable->units = "nT";
+        variable->valid_min = element == 'S' ? 0.0 : -80000.0;
+        variable->valid_max = 80000.0;
+        break;
+    default:
+        variable->units = "nT";
+        variable->valid_min = -80000.0;
+        variable->valid_max = 80000.0;
+        break;
+    }
+}
+
+/* finish reading a file - drop columns that were never recorded, set the
+ * lengths and cadence, and hold regular time stamps in the compact form -
+ * store is the next free space in the string store */
+static void finish_import (struct IMCDFImportData *data, int n_samples, char *store)
+{
+    int count, n_variables, length;
+    long long step;
+    double *unused;
+    time_t now;
+    struct tm *utc, utc_buffer;
+
+    /* remove columns that hold no data - data_len was set if the column
+     * held anything other than the not recorded value */
+    n_variables = 0;
+    for (count=0; count<data->n_variables; count++)
+    {
+        if (data->variables[count].data_len)
+        {
+            if (count != n_variables)
+            {
+                unused = data->variables[n_variables].data;
+                data->variables[n_variables] = data->variables[count];
+                data->variables[count].data = unused;
+            }
+            data->variables[n_variables ++].data_len = n_samples;
+        }
+    }
+    data->n_variables = n_variables;
+
+    /* attributes that an ImagCDF reader requires but that the file
+     * may not have supplied */
+    if (! data->global_attrs.institution || ! *(data->global_attrs.institution))
+        data->global_attrs.institution = "Unknown";
+    if (! data->global_attrs.observatory_name || ! *(data->global_attrs.observatory_name))
+        data->global_attrs.observatory_name = data->global_attrs.iaga_code;
+
+    /* the elements recorded, taken from the variables */
+    data->global_attrs.elements_recorded = store;
+    for (count=0; count<n_variables; count++) *store ++ = data->variables[count].elem_rec [0];
+    *store = '\0';
+
+    /* the time stamps */
+    data->ts.data_len = n_samples;
+    step = n_samples > 1 ? *(data->ts.time_stamps +1) - *(data->ts.time_stamps) : 0;
+    for (count=2; count<n_samples; count++)
+    {
+        if (*(data->ts.time_stamps + count) - *(data->ts.time_stamps + count -1) != step) break;
+    }
+    switch (step / 1000000000ll)
+    {
+    case 1:     data->cadence = IMCDF_INT_SECOND; break;
+    case 60:    data->cadence = IMCDF_INT_MINUTE; break;
+    case 3600:  data->cadence = IMCDF_INT_HOURLY; break;
+    case 86400: data->cadence = IMCDF_INT_DAILY; break;
+    default:    data->cadence = IMCDF_INT_UNKNOWN; break;
+    }
+    length = (int) ((((long long) n_samples * step) / 1000000000ll) / 86400ll);
+    if (length <= 1) data->coverage = IMCDF_INT_DAILY;
+    else if (length <= 31) data->coverage = IMCDF_INT_MONTHLY;
+    else data->coverage = IMCDF_INT_ANNUAL;
+    if (n_samples > 1 && count >= n_samples)
+    {
+        data->ts.start = *(data->ts.time_stamps);
+        data->ts.step = step;
+        free (data->ts.time_stamps);
+        data->ts.time_stamps = 0;
+    }
+
+    /* the publication date is the time of the conversion */
+    now = time (0);
+    utc = gmtime_r (&now, &utc_buffer);
+    imcdf_date_time_to_tt2000 (utc->tm_year + 1900, utc->tm_mon +1, utc->tm_mday,
+                               utc->tm_hour, utc->tm_min, utc->tm_sec,
+                               &(data->global_attrs.pub_date));
+}
+
+/* decide which format a file is in from its first line - IAGA-2002 files
+ * start with the Format header line, IMF files with the IAGA code and date */
+static int file_format (char *filename)
+{
+    FILE *fp;
+    char buffer [20];
+    size_t length;
+
+    fp = fopen (filename, "rb");
+    if (! fp) return IMCDF_IMPORT_UNKNOWN;
+    length = fread (buffer, 1, sizeof (buffer) -1, fp);
+    fclose (fp);
+    buffer [length] = '\0';
+
+    if (! strncmp (buffer, " Format", 7)) return IMCDF_IMPORT_IAGA2002;
+    if (length >= 11 && isalpha (buffer [0]) && buffer [3] == ' ' && imf_month (buffer + 4))
+        return IMCDF_IMPORT_IMF;
+    return IMCDF_IMPORT_UNKNOWN;
+}
+
+/* decode the month in an IMF date - returns 1 to 12, or 0 if the month isn't valid */
+static int imf_month (char *ptr)
+{
+    static const char *months = "JANFEBMARAPRMAYJUNJULAUGSEPOCTNOVDEC";
+    int count;
+
+    for (count=0; count<12; count++)
+    {
+        if (toupper (ptr [0]) == months [count * 3] && toupper (ptr [1]) == months [(count * 3) +1] &&
+            toupper (ptr [2]) == months [(count * 3) +2])
+            return count +1;
+    }
+    return 0;
+}
+
+/* find all the files in a directory tree - returns -1 if a directory
+ * couldn't be read */
+static int collect_files (char *dir_name, char ***filenames, int *n_files, int *n_alloc)
+{
+    int result;
+    char path [IMCDF_FILENAME_LEN], **new_filenames;
+    DIR *dir;
+    struct dirent *entry;
+    struct stat stat_buf;
+
+    dir = opendir (dir_name);
+    if (! dir) return -1;
+    result = 0;
+    while (! result && (entry = readdir (dir)) != 0)
+    {
+        if (entry->d_name [0] == '.') continue;
+        if (snprintf (path, sizeof (path), "%s/%s", dir_name, entry->d_name) >= (int) sizeof (path)) continue;
+        if (stat (path, &stat_buf)) continue;
+        if (S_ISDIR (stat_buf.st_mode))
+            result = collect_files (path, filenames, n_files, n_alloc);
+        else if (S_ISREG (stat_buf.st_mode))
+        {
+            if (*n_files >= *n_alloc)
+            {
+                new_filenames = realloc (*filenames, sizeof (char *) * (*n_alloc + 256));
+                if (! new_filenames)
+                {
+                    result = -1;
+                    break;
+                }
+                *filenames = new_filenames;
+                *n_alloc += 256;
+            }
+            *(*filenames + *n_files) = strdup (path);
+            if (! *(*filenames + *n_files)) result = -1;
+            else (*n_files) ++;
+        }
+    }
+    closedir (dir);
+    return result;
+}
+
+/* convert a file - if job is not null the name of the ImagCDF file is
+ * claimed in the job's list of output names, so that two input files that
+ * make the same name are not written to the one file at once */
+static char *import_file (char *in_filename, char *out_dir,
+                          enum IMCDFCompressionType compress_type, char *out_filename,
+                          struct ImportJob *job)
+{
+    int cdf_handle, length;
+    char *err_msg, *close_msg, prefix [IMCDF_FILENAME_LEN - 100], filename [IMCDF_FILENAME_LEN];
+    long long start_date;
+    struct IMCDFImportData data;
+
+    err_msg = imcdf_read_import_file (in_filename, &data);
+    if (err_msg) return err_msg;
+    if (data.ts.data_len <= 0 || data.n_variables <= 0)
+    {
+        imcdf_free_import (&data);
+        return imcdf_format_error (IMCDF_ERROR_INVALID_FORMAT, "No data in file", in_filename, CDF_OK);
+    }
+    if (! data.global_attrs.iaga_code)
+    {
+        imcdf_free_import (&data);
+        return imcdf_format_error (IMCDF_ERROR_INVALID_FORMAT, "No IAGA code in file", in_filename, CDF_OK);
+    }
+
+    /* name the file after its contents */
+    prefix [0] = '\0';
+    if (out_dir && *out_dir)
+    {
+        length = (int) strlen (out_dir);
+        if (length + 2 > (int) sizeof (prefix))
+        {
+            imcdf_free_import (&data);
+            return imcdf_format_error (IMCDF_ERROR_INVALID_ARGUMENT, "Output directory name too long", out_dir, CDF_OK);
+        }
+        strcpy (prefix, out_dir);
+        if (prefix [length -1] != '/') strcat (prefix, "/");
+    }
+    start_date = imcdf_get_time_stamp (&(data.ts), 0);
+    imcdf_make_filename (prefix, data.global_attrs.iaga_code, start_date,
+                         data.global_attrs.pub_level, data.cadence, data.coverage,
+                         1, filename);
+    if (out_filename) strcpy (out_filename, filename);
+    if (job)
+    {
+        pthread_mutex_lock (&(job->lock));
+        err_msg = claim_out_filename (job, filename);
+        pthread_mutex_unlock (&(job->lock));
+        if (err_msg)
+        {
+            imcdf_free_import (&data);
+            return err_msg;
+        }
+    }
+
+    err_msg = imcdf_open2 (filename, IMCDF_FORCE_CREATE, compress_type, &cdf_handle);
+    if (! err_msg)
+    {
+        err_msg = imcdf_write_import (cdf_handle, &data);
+        close_msg = imcdf_close2 (cdf_handle);
+        if (! err_msg) err_msg = close_msg;
+    }
+    imcdf_free_import (&data);
+    return err_msg;
+}
+
+/* add the name of an ImagCDF file to the job's sorted list of output
+ * names - the job must be locked. Returns an error message if the name
+ * was already in the list or there was no memory to add it */
+static char *claim_out_filename (struct ImportJob *job, char *filename)
+{
+    int lo, hi, mid, cmp;
+    char *copy, **names;
+
+    lo = 0;
+    hi = job->n_out_names;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        cmp = strcmp (*(job->out_names + mid), filename);
+        if (cmp == 0)
+            return imcdf_format_error (IMCDF_ERROR_INVALID_ARGUMENT, "Output file already made from another input file", filename, CDF_OK);
+        if (cmp < 0) lo = mid +1;
+        else hi = mid;
+    }
+    if (job->n_out_names >= job->n_out_alloc)
+    {
+        names = realloc (job->out_names, sizeof (char *) * (job->n_out_alloc + 100));
+        if (! names) return imcdf_format_error (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", filename, CDF_OK);
+        job->out_names = names;
+        job->n_out_alloc += 100;
+    }
+    copy = strdup (filename);
+    if (! copy) return imcdf_format_error (IMCDF_ERROR_NO_MEMORY, "Error allocating memory", filename, CDF_OK);
+    memmove (job->out_names + lo +1, job->out_names + lo, sizeof (char *) * (job->n_out_names - lo));
+    *(job->out_names + lo) = copy;
+    job->n_out_names ++;
+    return 0;
+}
+
+/* a thread that converts files from a job until there are none left */
+static void *import_thread (void *arg)
+{
+    int file_no;
+    char *err_msg;
+    struct ImportJob *job;
+
+    job = (struct ImportJob *) arg;
+    for (;;)
+    {
+        pthread_mutex_lock (&(job->lock));
+        file_no = job->next_file ++;
+        pthread_mutex_unlock (&(job->lock));
+        if (file_no >= job->n_files) break;
+
+        /* files in other formats are skipped without comment */
+        if (file_format (*(job->filenames + file_no)) == IMCDF_IMPORT_UNKNOWN) continue;
+        err_msg = import_file (*(job->filenames + file_no), job->out_dir, job->compress_type, 0, job);
+
+        pthread_mutex_lock (&(job->lock));
+        if (! err_msg)
+            job->n_converted ++;
+        else
+        {
+            job->n_failed ++;
+            if (job->log) fprintf (job->log, "%s: %s\n", *(job->filenames + file_no), err_msg);
+        }
+        pthread_mutex_unlock (&(job->lock));
+    }
+    return 0;
+}
@@ -8,8 +8,16 @@
  *
  * This code only used Extended Standard Interface functions
  *
- * access to an open CDF is controlled by a CDF handle, which is an index into
- * an array of CDFid elements
+ * access to an open CDF is controlled by a CDF handle, which holds an index into
+ * a table of structures holding the CDFid and settings for each open file,
+ * along with a generation number that is changed each time an entry in the
+ * table is reused, so that a handle that has been closed can't be used to
+ * access a different file
+ *
+ * different CDF files may be used from different threads at the same time -
+ * opening and closing files is protected by a lock and the status of the
+ * last call to the CDF library is held separately for each thread. A single
+ * CDF handle must not be used by more than one thread at a time
  *
  * Simon Flower, 19/12/2012
  * Updates to version 1.1 of ImagCDF. Simon Flower, 19/02/2015  
@@ -19,26 +27,165 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include "cdf.h"
 
 #include "imcdf.h"
 
 /* private global variables: */
-/* an array of CDF ids - this allows for more than one CDF file to be kept open
- * at a time, though in reality it's unlikely that more than one will ever be
- * open simultaneously */
-#define MAX_OPEN_CDF_FILES    10
-static CDFid cdf_ids [MAX_OPEN_CDF_FILES];
-static int cdf_index = -1;
-/* the status of the last call to the CDF library */
-CDFstatus cdf_status;
+/* a cache of the numbers that the CDF library uses to identify variables and
+ * attributes, looked up by name - the cache is a hash table using linear
+ * probing - names that are too long to fit in an entry are not cached */
+#define NAME_CACHE_SIZE       128
+#define NAME_CACHE_NAME_LEN   48
+#define NAME_CACHE_VARIABLE   'v'
+#define NAME_CACHE_ATTRIBUTE  'a'
+struct NameCacheEntry
+{
+    char type;
+    char name [NAME_CACHE_NAME_LEN];
+    /* the variable or attribute number, or the (negative) status code from
+     * the CDF library if the name was not found */
+    long number;
+};
+/* a variable that is being written in a streaming session - records are
+ * held in a buffer until the session is flushed */
+struct StreamVar
+{
+    long var_num;
+    long next_rec;
+    char *buffer;
+    size_t rec_size;
+    long n_buffered;
+};
+/* a streaming session - data for each variable is flushed when its buffer
+ * is full, all variables are flushed when the time since the last flush
+ * exceeds a limit */
+struct StreamSession
+{
+    int flush_records;
+    int flush_seconds;
+    time_t last_flush;
+    struct StreamVar *vars;
+    int n_vars;
+};
+/* the states that an entry in the array of open CDFs can be in - an entry
+ * is reserved while the file is being opened so that other threads can't
+ * take it, but can't be used until the file is open */
+enum OpenCDFState {OPEN_CDF_FREE, OPEN_CDF_RESERVED, OPEN_CDF_OPEN};
+/* information held for each open CDF file */
+struct OpenCDF
+{
+    enum OpenCDFState state;
+    /* incremented each time the entry is freed - must match the generation
+     * in the CDF handle */
+    int generation;
+    /* the index of the next entry in the free list */
+    int next_free;
+    CDFid id;
+    /* the number of records passed to the CDF library in each call when
+     * writing data - 0 writes one record per call */
+    int write_chunk_size;
+    /* the number of records requested from the CDF library in each call
+     * when reading data - 0 reads one record per call */
+    int read_chunk_size;
+    /* variable and attribute numbers that have already been looked up */
+    struct NameCacheEntry name_cache [NAME_CACHE_SIZE];
+    /* the streaming session, or null if streaming has not been started */
+    struct StreamSession *stream;
+};
+/* a table of open CDFs - this allows for many CDF files to be kept open at
+ * a time. The table grows a page at a time as more files are opened - pages
+ * are never moved or freed, so an entry can be used without holding the lock.
+ * Entries that have been closed are kept on a free list for reuse. A CDF
+ * handle is made from an index into the table (in the low bits) and the
+ * generation number of the entry (in the high bits). Closed entries join the
+ * tail of the free list and are reused from its head, so closes are spread
+ * over every entry in the table - a stale handle can only match a reused
+ * entry again once its generation wraps, which takes (number of entries in
+ * the table x 2048) closes, or 2048 closes if only one file is ever open */
+#define HANDLE_INDEX_BITS         20
+#define HANDLE_GENERATION_MASK    ((1 << (31 - HANDLE_INDEX_BITS)) -1)
+#define MAX_OPEN_CDF_FILES        (1 << HANDLE_INDEX_BITS)
+#define OPEN_CDF_PAGE_SIZE        256
+#define MAX_OPEN_CDF_PAGES        (MAX_OPEN_CDF_FILES / OPEN_CDF_PAGE_SIZE)
+#define MAKE_HANDLE(index,generation) (((generation) << HANDLE_INDEX_BITS) | (index))
+#define HANDLE_INDEX(handle)      ((handle) & (MAX_OPEN_CDF_FILES -1))
+#define HANDLE_GENERATION(handle) ((handle) >> HANDLE_INDEX_BITS)
+#define OPEN_CDF(handle)          (open_cdf_pages [HANDLE_INDEX (handle) / OPEN_CDF_PAGE_SIZE] \
+                                                  [HANDLE_INDEX (handle) % OPEN_CDF_PAGE_SIZE])
+static struct OpenCDF *open_cdf_pages [MAX_OPEN_CDF_PAGES];
+static int n_open_cdf_entries = 0;
+static int open_cdf_free_list = -1;
+static int open_cdf_free_tail = -1;
+/* a lock that must be held while an entry in the table of open CDFs is 
+ * reserved or freed */
+static pthread_mutex_t open_cdfs_lock = PTHREAD_MUTEX_INITIALIZER;
+/* the leap second table, loaded from the CDF library the first time it is
+ * needed - only leap seconds from 1972 onwards (when the offset between TAI
+ * and UTC became a whole number of seconds) are held. Days are counted from
+ * 1970-01-01 */
+#define LEAP_SECONDS_START_YEAR   1972
+static pthread_once_t leap_seconds_once = PTHREAD_ONCE_INIT;
+static long *leap_second_days = 0;
+static int *leap_second_values = 0;
+static int n_leap_seconds = 0;
+/* round a size up to the alignment of memory allocated from an arena */
+#define ARENA_ROUND(n)            (((n) + (IMCDF_ARENA_ALIGN -1)) & ~((size_t) (IMCDF_ARENA_ALIGN -1)))
+/* the status of the last call to the CDF library made by this thread */
+static IMCDF_THREAD_LOCAL CDFstatus cdf_status = CDF_OK;
 
 /* private forward declarations  */
-static void initialise_cdf_ids ();
+static int reserve_open_cdf ();
+static void release_open_cdf (int cdf_handle);
 static int sanity_check_handles (int cdf_handle);
+static enum IMCDFCompressionType compression_type (long c_type, long *c_parms);
+static int compression_params (enum IMCDFCompressionType compress_type, 
+                               long *c_type, long *c_parms);
+static int create_var (int cdf_handle, char *name, long data_type, void *data,
+                       int data_length, struct IMCDFVarOptions *options);
+static enum IMCDFCompressionType choose_compression (long data_type, void *data, 
+                                                     int data_length, int cpu_budget);
+static double thread_cpu_msec ();
+static long trial_compression (char *filename, enum IMCDFCompressionType compress_type,
+                               long data_type, void *data, long n_recs);
+static int allocate_records (int cdf_handle, long var_num, long n_recs);
+static void *arena_or_malloc (struct IMCDFArena *arena, size_t size);
 static long find_global_attribute (int cdf_handle, char *name);
 static long find_variable_attribute (int cdf_handle, char *name);
+static long get_var_num (int cdf_handle, char *name);
+static long get_attr_num (int cdf_handle, char *name);
+static void clear_name_cache (int cdf_handle);
+static void update_name_cache (int cdf_handle, char type, char *name, long number);
+static struct NameCacheEntry *find_name_cache_entry (int cdf_handle, char type, char *name);
+static int put_records (int cdf_handle, long var_num, long first_rec,
+                        void *data, long n_recs, size_t rec_size);
+static int get_records (int cdf_handle, long var_num, long first_rec,
+                        void *data, long n_recs, size_t rec_size);
+static int stream_append (int cdf_handle, char *name, long data_type, 
+                          void *data, int data_length, size_t rec_size);
+static int stream_flush_var (int cdf_handle, struct StreamVar *stream_var);
+static int append_records (int cdf_handle, char *name, void *data, int data_length,
+                           size_t rec_size);
+static void free_stream (int cdf_handle);
+static int check_var (int cdf_handle, char *var_name, long data_type, 
+                      long *var_num, long *n_recs);
+static int get_time_stamp (int cdf_handle, long var_num, long rec_num, long long *tt2000);
+static void read_leap_seconds ();
+static void load_leap_seconds ();
+static int leap_seconds_at_day (long day);
+static long days_from_civil (long year, int month, int day);
+static void civil_from_days (long days, int *year, int *month, int *day);
+static int find_day (long long tt2000, struct IMCDFDateTime *date_time, 
+                     long long *day_start, long long *day_end);
+static void put_digits (char *buffer, int value, int n_digits);
+static int check_range_boundary (int cdf_handle, long var_num, long n_recs,
+                                 long rec_num, long long tt2000, int is_start);
+static long search_time_stamps (int cdf_handle, long var_num, long n_recs,
+                                long long tt2000, int is_start);
     
 /** ------------------------------------------------------------------------
  *  --------------------- Opening and closing CDF files --------------------
@@ -61,13 +208,13 @@ static long find_variable_attribute (int cdf_handle, char *name);
 int imcdf_open (char *filename, enum IMCDFOpenType open_type,
                 enum IMCDFCompressionType compress_type)
 {
-    long cparams [1];
+    int cdf_handle;
+    long c_type, c_parms [CDF_MAX_PARMS];
     CDFid id;
 
-    initialise_cdf_ids ();
-    
-    /* check there is space to open another file */
-    if (cdf_index >= MAX_OPEN_CDF_FILES) return -1;
+    /* find space to open another file */
+    cdf_handle = reserve_open_cdf ();
+    if (cdf_handle < 0) return -1;
     
     /* open the file */
     switch (open_type)
@@ -75,87 +222,53 @@ int imcdf_open (char *filename, enum IMCDFOpenType open_type,
     case IMCDF_FORCE_CREATE:
         if (! access (filename, 0)) remove (filename);
         cdf_status = CDFcreateCDF (filename, &id);
-    if (cdf_status < CDF_WARN) return -1;
         break;
     case IMCDF_CREATE:
         cdf_status = CDFcreateCDF (filename, &id);
-        if (cdf_status < CDF_WARN) return -1;
         break;
     case IMCDF_OPEN:
         cdf_status = CDFopenCDF (filename, &id);
-        if (cdf_status < CDF_WARN) return -1;
         compress_type = IMCDF_COMPRESS_NONE;
         break;
     default:
-    return -1;
+        release_open_cdf (cdf_handle);
+        return -1;
+    }
+    if (cdf_status < CDF_WARN) 
+    {
+        release_open_cdf (cdf_handle);
+        return -1;
     }
     
     /* set the compression */
-    switch (compress_type)
+    if (compression_params (compress_type, &c_type, c_parms))
+        cdf_status = CDFsetCompression (id, c_type, c_parms);
+    if (cdf_status < CDF_WARN) 
     {
-    case IMCDF_COMPRESS_RLE:
-        cparams [0] = RLE_OF_ZEROs;
-        cdf_status = CDFsetCompression (id, RLE_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_HUFF:
-        cparams [0] = OPTIMAL_ENCODING_TREES;
-        cdf_status = CDFsetCompression (id, HUFF_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_AHUFF:
-        cparams [0] = OPTIMAL_ENCODING_TREES;
-        cdf_status = CDFsetCompression (id, AHUFF_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP1:
-        cparams [0] = 1l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP2:
-        cparams [0] = 2l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP3:
-        cparams [0] = 3l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP4:
-        cparams [0] = 4l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP5:
-        cparams [0] = 5l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP6:
-        cparams [0] = 6l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP7:
-        cparams [0] = 7l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP8:
-        cparams [0] = 8l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    case IMCDF_COMPRESS_GZIP9:
-        cparams [0] = 9l;
-        cdf_status = CDFsetCompression (id, GZIP_COMPRESSION, cparams);
-        break;
-    default:
-        break;
+        CDFcloseCDF (id);
+        release_open_cdf (cdf_handle);
+        return -1;
     }
-    if (cdf_status < CDF_WARN) return -1;
 
-    /* insert the ID */
-    cdf_ids [cdf_index] = id;
-    return cdf_index ++;
+    /* insert the ID - the entry can't be used by other calls until
+     * its state is set to open */
+    OPEN_CDF (cdf_handle).id = id;
+    OPEN_CDF (cdf_handle).write_chunk_size = IMCDF_DEFAULT_WRITE_CHUNK_SIZE;
+    OPEN_CDF (cdf_handle).read_chunk_size = IMCDF_DEFAULT_READ_CHUNK_SIZE;
+    OPEN_CDF (cdf_handle).stream = 0;
+    clear_name_cache (cdf_handle);
+    pthread_mutex_lock (&open_cdfs_lock);
+    OPEN_CDF (cdf_handle).state = OPEN_CDF_OPEN;
+    pthread_mutex_unlock (&open_cdfs_lock);
+    return cdf_handle;
 }
 
 /*****************************************************************************
  * imcdf_close
  *
  * Description: close a CDF - you MUST call this after writing to the CDF 
- *              otherwise it will be corrupt
+ *              otherwise it will be corrupt. Any data buffered by a 
+ *              streaming session is written before the CDF is closed
  *
  * Input parameters: cdf_handle - the CDF to close
  * Output parameters: none
@@ -165,19 +278,69 @@ int imcdf_open (char *filename, enum IMCDFOpenType open_type,
  int imcdf_close (int cdf_handle)
  
  {
-    int count;
+    CDFstatus flush_status;
 
     if (sanity_check_handles (cdf_handle)) return -1;
 
+    /* write any data buffered by a streaming session */
+    flush_status = CDF_OK;
+    if (OPEN_CDF (cdf_handle).stream)
+    {
+        if (imcdf_stream_flush (cdf_handle)) flush_status = cdf_status;
+        free_stream (cdf_handle);
+    }
+
     /* close the CDF */
-    cdf_status = CDFcloseCDF (cdf_ids [cdf_handle]);
+    cdf_status = CDFcloseCDF (OPEN_CDF (cdf_handle).id);
     if (cdf_status < CDF_WARN) return -1;
 
-    /* sort out the array of CDF ids */
-    for (count=cdf_handle +1; count<cdf_index; count++)
-        cdf_ids [count -1] = cdf_ids [count];
-    cdf_index --;
+    /* free the entry in the array of open CDFs */
+    release_open_cdf (cdf_handle);
     
+    if (flush_status != CDF_OK)
+    {
+        cdf_status = flush_status;
+        return -1;
+    }
+    return 0;
+}
+
+
+/*****************************************************************************
+ * imcdf_set_write_chunk_size
+ * imcdf_set_read_chunk_size
+ *
+ * Description: set the number of records that are passed to the CDF library
+ *              in each call when writing data to a CDF
+ *              set the number of records that are requested from the CDF
+ *              library in each call when reading data from a CDF
+ *
+ * Input parameters: cdf_handle - the CDF to configure
+ *                   chunk_size - the number of records per call, 0 to
+ *                                transfer one record per call (the original
+ *                                behaviour of this library)
+ * Output parameters: none
+ * Returns: 0 for success, -1 for failure
+ *
+ *****************************************************************************/
+int imcdf_set_write_chunk_size (int cdf_handle, int chunk_size)
+
+{
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (chunk_size < 0) return -1;
+
+    OPEN_CDF (cdf_handle).write_chunk_size = chunk_size;
+    return 0;
+}
+
+
+int imcdf_set_read_chunk_size (int cdf_handle, int chunk_size)
+
+{
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (chunk_size < 0) return -1;
+
+    OPEN_CDF (cdf_handle).read_chunk_size = chunk_size;
     return 0;
 }
 
@@ -213,7 +376,7 @@ int imcdf_add_global_attr_string (int cdf_handle, char *attr_name, int entry_no,
     {
         attr_num = find_global_attribute (cdf_handle, attr_name);
         if (attr_num < 0l) return -1;
-        cdf_status = CDFputAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, CDF_CHAR, (long) strlen (value), value);
+        cdf_status = CDFputAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, CDF_CHAR, (long) strlen (value), value);
         if (cdf_status < CDF_WARN) return -1;
     }
     
@@ -232,7 +395,7 @@ int imcdf_add_global_attr_double (int cdf_handle, char *attr_name, int entry_no,
     attr_num = find_global_attribute (cdf_handle, attr_name);
     if (attr_num < 0l) return -1;
     values [0] = value;
-    cdf_status = CDFputAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, CDF_DOUBLE, 1l, values);
+    cdf_status = CDFputAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, CDF_DOUBLE, 1l, values);
     if (cdf_status < CDF_WARN) return -1;
     
     return 0;
@@ -250,7 +413,7 @@ int imcdf_add_global_attr_tt2000 (int cdf_handle, char *attr_name, int entry_no,
     attr_num = find_global_attribute (cdf_handle, attr_name);
     if (attr_num < 0l) return -1;
     values [0] = value;
-    cdf_status = CDFputAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, CDF_TIME_TT2000, 1l, values);
+    cdf_status = CDFputAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, CDF_TIME_TT2000, 1l, values);
     if (cdf_status < CDF_WARN) return -1;
     
     return 0;
@@ -284,14 +447,14 @@ int imcdf_add_variable_attr_string (int cdf_handle, char *attr_name,
     attr_num = find_variable_attribute (cdf_handle, attr_name);
     if (attr_num < 0l) return -1;
 
-    var_num = CDFgetVarNum (cdf_ids [ cdf_handle], var_name);
+    var_num = get_var_num (cdf_handle, var_name);
     if (var_num < 0l)
     {
         cdf_status = (CDFstatus) var_num;
         return -1;
     }
     
-    cdf_status = CDFputAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, CDF_CHAR, (long) strlen (value), value);
+    cdf_status = CDFputAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, CDF_CHAR, (long) strlen (value), value);
     if (cdf_status < CDF_WARN) return -1;
     
     return 0;
@@ -310,7 +473,7 @@ int imcdf_add_variable_attr_double (int cdf_handle, char *attr_name,
     attr_num = find_variable_attribute (cdf_handle, attr_name);
     if (attr_num < 0l) return -1;
 
-    var_num = CDFgetVarNum (cdf_ids [ cdf_handle], var_name);
+    var_num = get_var_num (cdf_handle, var_name);
     if (var_num < 0l)
     {
         cdf_status = (CDFstatus) var_num;
@@ -318,7 +481,7 @@ int imcdf_add_variable_attr_double (int cdf_handle, char *attr_name,
     }
     
     values [0] = value;
-    cdf_status = CDFputAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, 
+    cdf_status = CDFputAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, 
                                    CDF_DOUBLE, 1l, values);
     if (cdf_status < CDF_WARN) return -1;
     
@@ -339,7 +502,7 @@ int imcdf_add_variable_attr_tt2000 (int cdf_handle, char *attr_name,
     attr_num = find_variable_attribute (cdf_handle, attr_name);
     if (attr_num < 0l) return -1;
 
-    var_num = CDFgetVarNum (cdf_ids [ cdf_handle], var_name);
+    var_num = get_var_num (cdf_handle, var_name);
     if (var_num < 0l)
     {
         cdf_status = (CDFstatus) var_num;
@@ -347,7 +510,7 @@ int imcdf_add_variable_attr_tt2000 (int cdf_handle, char *attr_name,
     }
     
     values [0] = value;
-    cdf_status = CDFputAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, 
+    cdf_status = CDFputAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, 
                                    CDF_TIME_TT2000, 1l, values);
     if (cdf_status < CDF_WARN) return -1;
     
@@ -355,19 +518,52 @@ int imcdf_add_variable_attr_tt2000 (int cdf_handle, char *attr_name,
 
 }
 
+/****************************************************************************
+ * imcdf_init_var_options
+ *
+ * Description: set the options used when creating a variable to their
+ *              default values - no compression of the variable (other than
+ *              compression of the whole file set in imcdf_open ()), the
+ *              default blocking factor and no expected length
+ *
+ * Input parameters: 
+ * Output parameters: options - the options to initialise
+ * Returns: 
+ *
+ ****************************************************************************/
+void imcdf_init_var_options (struct IMCDFVarOptions *options)
+
+{
+    options->compress_type = IMCDF_COMPRESS_INHERIT;
+    options->blocking_factor = 0;
+    options->expected_records = 0;
+    options->auto_cpu_budget = 0;
+    options->compress_type_used = IMCDF_COMPRESS_INHERIT;
+}
+
 /****************************************************************************
  * imcdf_create_data_array
  * imcdf_create_time_stamp_array
+ * imcdf_create_data_array_opt
+ * imcdf_create_time_stamp_array_opt
  * imcdf_append_data_array
  * imcdf_append_time_stamp_array
  *
  * create a data array or a time stamp array in the CDF file
  * append data to a data array or a time stamp aray in the CDF file
  *
+ * Data is passed to the CDF library in blocks of records (see
+ * imcdf_set_write_chunk_size) rather than one record at a time. When a
+ * variable is created, space for all its records is allocated in one go,
+ * so that the CDF library doesn't extend the variable repeatedly
+ *
  * Input parameters: cdf_handle - handle to the CDF file
  *                   name - the variable name
  *                   data - the data to write into the variable
  *                   data_length - the number of elements of data to write
+ *                   options - for the _opt routines, the compression and 
+ *                             blocking factor for the variable, or null
+ *                             to use the defaults (see IMCDFVarOptions)
  * Output parameters:
  * Returns: 0 for success, -1 for failure
  *
@@ -376,17 +572,7 @@ int imcdf_create_data_array (int cdf_handle, char *name, double *data,
                              int data_length)
 
 {
-    long var_num, dim_size [1], dim_var [1];
-        
-    if (sanity_check_handles (cdf_handle)) return -1;
-
-    dim_size [0] = 1;
-    dim_var [0] = VARY;
-    cdf_status = CDFcreatezVar (cdf_ids [cdf_handle], name, CDF_DOUBLE,
-                1l, 0l, dim_size, VARY, dim_var, &var_num);
-    if (cdf_status < CDF_WARN) return -1;
-
-    return imcdf_append_data_array (cdf_handle, name, data, data_length);    
+    return imcdf_create_data_array_opt (cdf_handle, name, data, data_length, 0);
 }
 
 
@@ -394,15 +580,27 @@ int imcdf_create_time_stamp_array (int cdf_handle, char *name, long long *data,
                                    int data_length)
 
 {
-    long var_num, dim_size [1], dim_var [1];
-        
+    return imcdf_create_time_stamp_array_opt (cdf_handle, name, data, data_length, 0);
+}
+
+
+int imcdf_create_data_array_opt (int cdf_handle, char *name, double *data,
+                                 int data_length, struct IMCDFVarOptions *options)
+
+{
     if (sanity_check_handles (cdf_handle)) return -1;
+    if (create_var (cdf_handle, name, CDF_DOUBLE, data, data_length, options)) return -1;
 
-    dim_size [0] = 1;
-    dim_var [0] = VARY;
-    cdf_status = CDFcreatezVar (cdf_ids [cdf_handle], name, CDF_TIME_TT2000,
-                1l, 0l, dim_size, VARY, dim_var, &var_num);
-    if (cdf_status < CDF_WARN) return -1;
+    return imcdf_append_data_array (cdf_handle, name, data, data_length);    
+}
+
+
+int imcdf_create_time_stamp_array_opt (int cdf_handle, char *name, long long *data,
+                                       int data_length, struct IMCDFVarOptions *options)
+
+{
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (create_var (cdf_handle, name, CDF_TIME_TT2000, data, data_length, options)) return -1;
 
     return imcdf_append_time_stamp_array (cdf_handle, name, data, data_length);    
 }
@@ -412,65 +610,181 @@ int imcdf_append_data_array (int cdf_handle, char *name, double *data,
                              int data_length)
 
 {
-    long var_num, n_recs, count;
-        
     if (sanity_check_handles (cdf_handle)) return -1;
 
-    var_num = CDFgetVarNum (cdf_ids [cdf_handle], name);
-    if (var_num < 0)
+    return append_records (cdf_handle, name, data, data_length, sizeof (double));
+}
+
+
+int imcdf_append_time_stamp_array (int cdf_handle, char *name, long long *data,
+                                   int data_length)
+
+{
+    if (sanity_check_handles (cdf_handle)) return -1;
+
+    return append_records (cdf_handle, name, data, data_length, sizeof (long long));
+}
+    
+/** ------------------------------------------------------------------------
+ *  ---------------------- Streaming data to CDF files ---------------------
+ *  ------------------------------------------------------------------------*/
+
+/****************************************************************************
+ * imcdf_stream_start
+ *
+ * Description: start a streaming session on a CDF that is being written - 
+ *              data appended during the session is held in memory and 
+ *              written to the CDF in large batches, so that adding samples
+ *              one at a time (e.g. when recording in real time) does not 
+ *              call the CDF library for every sample. The variables that
+ *              are streamed must already exist in the CDF - they may be
+ *              created empty, e.g. using imcdf_write_variable () with
+ *              data_len set to 0. The session ends when the CDF is closed.
+ *              imcdf_append_data_array () and imcdf_append_time_stamp_array ()
+ *              may still be used on a variable in the session - they write
+ *              its buffered data first, then append after it
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   flush_records - the number of records to buffer for
+ *                                   each variable before writing them
+ *                   flush_seconds - write all buffered data when this many
+ *                                   seconds have passed since data was
+ *                                   last written, 0 for no time limit
+ * Output parameters:
+ * Returns: 0 for success, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_stream_start (int cdf_handle, int flush_records, int flush_seconds)
+
+{
+    struct StreamSession *stream;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (flush_records <= 0 || flush_seconds < 0)
     {
-        cdf_status = var_num;
+        cdf_status = BAD_ARGUMENT;
         return -1;
     }
-    
-    cdf_status = CDFgetzVarMaxWrittenRecNum (cdf_ids [cdf_handle], var_num, &n_recs);
-    if (cdf_status != CDF_OK) return -1;
-    if (n_recs < 0) n_recs = 0;
-    
-    for (count=0; count<data_length; count++)
+
+    /* restarting a session - write the data buffered with the old settings */
+    if (OPEN_CDF (cdf_handle).stream)
     {
-        cdf_status = CDFputzVarRecordData (cdf_ids [cdf_handle], var_num, count + n_recs, data + count);
-        if (cdf_status < CDF_WARN) return -1;
+        if (imcdf_stream_flush (cdf_handle)) return -1;
+        free_stream (cdf_handle);
+    }
+
+    stream = malloc (sizeof (struct StreamSession));
+    if (! stream)
+    {
+        cdf_status = BAD_MALLOC;
+        return -1;
     }
+    stream->vars = 0;
+    stream->n_vars = 0;
+    OPEN_CDF (cdf_handle).stream = stream;
 
+    stream->flush_records = flush_records;
+    stream->flush_seconds = flush_seconds;
+    stream->last_flush = time (0);
     return 0;
 }
 
+/****************************************************************************
+ * imcdf_stream_append_data
+ * imcdf_stream_append_time_stamps
+ *
+ * Description: append data to a data array or a time stamp array in a
+ *              streaming session
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   name - the variable name
+ *                   data - the data to append
+ *                   data_length - the number of elements of data to append
+ * Output parameters:
+ * Returns: 0 for success, -1 for failure - on failure none of the data
+ *          has been accepted, so the call may be repeated
+ *
+ ****************************************************************************/
+int imcdf_stream_append_data (int cdf_handle, char *name, double *data,
+                              int data_length)
+
+{
+    return stream_append (cdf_handle, name, CDF_DOUBLE, data, data_length, sizeof (double));
+}
 
-int imcdf_append_time_stamp_array (int cdf_handle, char *name, long long *data,
-                                   int data_length)
+
+int imcdf_stream_append_time_stamps (int cdf_handle, char *name, long long *data,
+                                     int data_length)
 
 {
-    long var_num, n_recs, count;
-        
+    return stream_append (cdf_handle, name, CDF_TIME_TT2000, data, data_length, sizeof (long long));
+}
+
+/****************************************************************************
+ * imcdf_stream_flush
+ *
+ * Description: write all data buffered in a streaming session to the CDF
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ * Output parameters:
+ * Returns: 0 for success, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_stream_flush (int cdf_handle)
+
+{
+    int count;
+    struct StreamSession *stream;
+
     if (sanity_check_handles (cdf_handle)) return -1;
+    stream = OPEN_CDF (cdf_handle).stream;
+    if (! stream) return 0;
 
-    var_num = CDFgetVarNum (cdf_ids [cdf_handle], name);
-    if (var_num < 0)
+    for (count=0; count<stream->n_vars; count++)
     {
-        cdf_status = var_num;
-        return -1;
+        if (stream_flush_var (cdf_handle, stream->vars + count)) return -1;
     }
+    stream->last_flush = time (0);
+    return 0;
+}
 
-    cdf_status = CDFgetzVarMaxWrittenRecNum (cdf_ids [cdf_handle], var_num, &n_recs);
-    if (cdf_status != CDF_OK) return -1;
-    if (n_recs < 0) n_recs = 0;
-    
-    for (count=0; count<data_length; count++)
+/****************************************************************************
+ * imcdf_stream_expect_records
+ *
+ * Description: tell the library how many records a variable in a streaming
+ *              session is expected to hold in total, so that space for them
+ *              can be allocated before they are written. This may be called
+ *              before or after the session is started
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   name - the variable name
+ *                   n_records - the total number of records expected
+ * Output parameters:
+ * Returns: 0 for success, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_stream_expect_records (int cdf_handle, char *name, int n_records)
+
+{
+    long var_num;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    var_num = get_var_num (cdf_handle, name);
+    if (var_num < 0l)
     {
-        cdf_status = CDFputzVarRecordData (cdf_ids [cdf_handle], var_num, count + n_recs, data + count);
-        if (cdf_status < CDF_WARN) return -1;
+        cdf_status = (CDFstatus) var_num;
+        return -1;
     }
-                               
-    return 0;
+    return allocate_records (cdf_handle, var_num, n_records);
 }
-    
+
 /** ------------------------------------------------------------------------
  *  ----------------------- Reading from CDF files -------------------------
  *  ------------------------------------------------------------------------*/
 
 /****************************************************************************
  * imcdf_get_global_attribute_string
+ * imcdf_get_global_attribute_string_arena
  * imcdf_get_global_attribute_double
  * imcdf_get_global_attribute_tt2000
  *
@@ -479,38 +793,51 @@ int imcdf_append_time_stamp_array (int cdf_handle, char *name, long long *data,
  * Input parameters: cdf_handle - handle to the CDF file
  *                   name - the name of the attribute
  *                   entry_no - the entry number required, 0..n_entries-1
+ *                   arena - the arena that strings are allocated from, or
+ *                           null to allocate them with malloc ()
  * Output parameters: value - the value of the attribute - for strings
  *                            this will point to dynamically allocated memory
  * Returns: 0 for success, -1 for failure
  *
  ****************************************************************************/
 int imcdf_get_global_attribute_string (int cdf_handle, char *name, int entry_no, char **value)
+{
+    return imcdf_get_global_attribute_string_arena (cdf_handle, name, entry_no, 0, value);
+}
+
+
+int imcdf_get_global_attribute_string_arena (int cdf_handle, char *name, int entry_no, 
+                                             struct IMCDFArena *arena, char **value)
 {
     long attr_num, data_type, num_elements;
     
     if (sanity_check_handles (cdf_handle)) return -1;
 
-    attr_num = CDFattrNum (cdf_ids [cdf_handle], name);
+    attr_num = get_attr_num (cdf_handle, name);
     if (attr_num < 0)
     {
         cdf_status = attr_num;
         return -1;
     }
     
-    cdf_status = CDFinquireAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, 
+    cdf_status = CDFinquireAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, 
                                        &data_type, &num_elements);
     if (cdf_status < 0) return -1;
     if (data_type != CDF_CHAR) return -1;
     
-    *value = malloc (num_elements +1);
+    *value = arena_or_malloc (arena, num_elements +1);
     if (! *value)
     {
         cdf_status = BAD_MALLOC;
         return -1;
     }
     
-    cdf_status = CDFgetAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, *value);
-    if (cdf_status < 0) return -1;
+    cdf_status = CDFgetAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, *value);
+    if (cdf_status < 0)
+    {
+        if (! arena) free (*value);
+        return -1;
+    }
     *((*value) + num_elements) = '\0';
     
     return 0;
@@ -523,19 +850,19 @@ int imcdf_get_global_attribute_double (int cdf_handle, char *name, int entry_no,
     
     if (sanity_check_handles (cdf_handle)) return -1;
 
-    attr_num = CDFattrNum (cdf_ids [cdf_handle], name);
+    attr_num = get_attr_num (cdf_handle, name);
     if (attr_num < 0)
     {
         cdf_status = attr_num;
         return -1;
     }
     
-    cdf_status = CDFinquireAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, 
+    cdf_status = CDFinquireAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, 
                                        &data_type, &num_elements);
     if (cdf_status < 0) return -1;
     if (data_type != CDF_DOUBLE) return -1;
     
-    cdf_status = CDFgetAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, value);
+    cdf_status = CDFgetAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, value);
     if (cdf_status < 0) return -1;
     
     return 0;
@@ -548,109 +875,278 @@ int imcdf_get_global_attribute_tt2000 (int cdf_handle, char *name, int entry_no,
     
     if (sanity_check_handles (cdf_handle)) return -1;
 
-    attr_num = CDFattrNum (cdf_ids [cdf_handle], name);
+    attr_num = get_attr_num (cdf_handle, name);
     if (attr_num < 0)
     {
         cdf_status = attr_num;
         return -1;
     }
     
-    cdf_status = CDFinquireAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, 
+    cdf_status = CDFinquireAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, 
                                        &data_type, &num_elements);
     if (cdf_status < 0) return -1;
     if (data_type != CDF_TIME_TT2000) return -1;
     
-    cdf_status = CDFgetAttrgEntry (cdf_ids [cdf_handle], attr_num, entry_no, value);
+    cdf_status = CDFgetAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, value);
     if (cdf_status < 0) return -1;
     
     return 0;
 }
 
 /****************************************************************************
- * imcdf_get_variable_attribute_string
- * imcdf_get_variable_attribute_double
- * imcdf_get_variable_attribute_tt2000
+ * imcdf_get_global_attribute_string_into
  *
- * Description: get the contents of a variable attribute
+ * Description: get the contents of a string global attribute into a buffer
+ *              supplied by the caller
  *
  * Input parameters: cdf_handle - handle to the CDF file
- *                      attr_name - the attribute name
- *                   var_name - the name of the variable
- * Output parameters: value - the value of the attribute - for strings
- *                            this will point to dynamically allocated memory
- * Returns: 0 for success, -1 for failure
+ *                   name - the name of the attribute
+ *                   entry_no - the entry number required, 0..n_entries-1
+ *                   capacity - the size of the value buffer, including
+ *                              space for the string terminator
+ * Output parameters: value - the value of the attribute
+ *                    length - the length of the string (excluding the
+ *                             terminator)
+ * Returns: 0 for success, 1 if the buffer is too small (in which case length
+ *          is still set), -1 for failure
  *
  ****************************************************************************/
-int imcdf_get_variable_attribute_string (int cdf_handle, char *attr_name, 
-                                         char *var_name, char **value)
-                                         
-{                                         
-    long var_num, attr_num, data_type, num_elements;
+int imcdf_get_global_attribute_string_into (int cdf_handle, char *name, int entry_no, 
+                                            char *value, int capacity, int *length)
+{
+    long attr_num, data_type, num_elements;
     
     if (sanity_check_handles (cdf_handle)) return -1;
 
-    var_num = CDFgetVarNum (cdf_ids [ cdf_handle], var_name);
-    if (var_num < 0l)
-    {
-        cdf_status = (CDFstatus) cdf_status;
-        return -1;
-    }
-    
-    attr_num = CDFattrNum (cdf_ids [cdf_handle], attr_name);
+    attr_num = get_attr_num (cdf_handle, name);
     if (attr_num < 0)
     {
         cdf_status = attr_num;
         return -1;
     }
     
-    cdf_status = CDFinquireAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, 
+    cdf_status = CDFinquireAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, 
                                        &data_type, &num_elements);
     if (cdf_status < 0) return -1;
     if (data_type != CDF_CHAR) return -1;
     
-    *value = malloc (num_elements +1);
-    if (! *value)
-    {
-        cdf_status = BAD_MALLOC;
-        return -1;
-    }
+    *length = (int) num_elements;
+    if (num_elements >= capacity) return 1;
     
-    cdf_status = CDFgetAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, *value);
+    cdf_status = CDFgetAttrgEntry (OPEN_CDF (cdf_handle).id, attr_num, entry_no, value);
     if (cdf_status < 0) return -1;
-    *((*value) + num_elements) = '\0';
+    *(value + num_elements) = '\0';
     
     return 0;
 }
 
+/****************************************************************************
+ * imcdf_get_n_attributes
+ *
+ * Description: find the number of attributes (global and variable) in a 
+ *              CDF file
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ * Output parameters: n_attrs - the number of attributes
+ * Returns: 0 for success, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_get_n_attributes (int cdf_handle, int *n_attrs)
+{
+    long n;
 
-int imcdf_get_variable_attribute_double (int cdf_handle, char *attr_name, 
-                                         char *var_name, double *value)
-                                         
+    if (sanity_check_handles (cdf_handle)) return -1;
+    cdf_status = CDFgetNumAttributes (OPEN_CDF (cdf_handle).id, &n);
+    if (cdf_status < CDF_WARN) return -1;
+    *n_attrs = (int) n;
+    return 0;
+}
+
+/****************************************************************************
+ * imcdf_get_attribute_info
+ *
+ * Description: describe an attribute given its number rather than its name,
+ *              so that all the attributes in a file can be read in one pass -
+ *              the attribute's name is put in the name cache
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   attr_num - the attribute number, from 0 to one less than
+ *                              the number from imcdf_get_n_attributes ()
+ *                   name_len - the size of the name buffer
+ * Output parameters: name - the attribute name (truncated if it won't fit)
+ *                    is_global - 1 for a global attribute, 0 for a variable
+ *                                attribute
+ *                    n_entries - for a global attribute, one more than the 
+ *                                highest entry number (entries below this
+ *                                may be missing), 0 for variable attributes
+ * Returns: 0 for success, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_get_attribute_info (int cdf_handle, int attr_num, char *name, int name_len,
+                              int *is_global, int *n_entries)
+{
+    long scope, max_g_entry, max_r_entry, max_z_entry;
+    char local_attr_name [CDF_ATTR_NAME_LEN256 +1];
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    cdf_status = CDFinquireAttr (OPEN_CDF (cdf_handle).id, (long) attr_num, local_attr_name,
+                                 &scope, &max_g_entry, &max_r_entry, &max_z_entry);
+    if (cdf_status < CDF_WARN) return -1;
+    snprintf (name, name_len, "%s", local_attr_name);
+    update_name_cache (cdf_handle, NAME_CACHE_ATTRIBUTE, local_attr_name, (long) attr_num);
+
+    *is_global = (scope == GLOBAL_SCOPE || scope == GLOBAL_SCOPE_ASSUMED);
+    *n_entries = *is_global ? (int) (max_g_entry +1l) : 0;
+    return 0;
+}
+
+/****************************************************************************
+ * imcdf_get_global_entry_info
+ * imcdf_get_global_entry
+ *
+ * Description: describe and get an entry of a global attribute, given the
+ *              attribute number (see imcdf_get_attribute_info) - the value
+ *              is copied as it is held in the file, so any CDF data type 
+ *              can be read - strings are not terminated
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   attr_num - the attribute number
+ *                   entry_no - the entry number
+ * Output parameters: data_type - the CDF data type of the entry
+ *                    n_elements - the number of elements in the entry 
+ *                                 (for strings the length of the string)
+ *                    n_bytes - the size of the value in bytes
+ *                    value - the value, which must have space for n_bytes
+ * Returns: 0 for success, 1 if the entry doesn't exist, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_get_global_entry_info (int cdf_handle, int attr_num, int entry_no,
+                                 long *data_type, int *n_elements, int *n_bytes)
+{
+    long num_elements, element_size;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    cdf_status = CDFinquireAttrgEntry (OPEN_CDF (cdf_handle).id, (long) attr_num, (long) entry_no, 
+                                       data_type, &num_elements);
+    if (cdf_status == NO_SUCH_ENTRY) return 1;
+    if (cdf_status < 0) return -1;
+    cdf_status = CDFgetDataTypeSize (*data_type, &element_size);
+    if (cdf_status < 0) return -1;
+    *n_elements = (int) num_elements;
+    *n_bytes = (int) (num_elements * element_size);
+    return 0;
+}
+
+int imcdf_get_global_entry (int cdf_handle, int attr_num, int entry_no, void *value)
+{
+    if (sanity_check_handles (cdf_handle)) return -1;
+    cdf_status = CDFgetAttrgEntry (OPEN_CDF (cdf_handle).id, (long) attr_num, (long) entry_no, value);
+    if (cdf_status == NO_SUCH_ENTRY) return 1;
+    if (cdf_status < 0) return -1;
+    return 0;
+}
+
+/****************************************************************************
+ * imcdf_get_variable_attribute_string
+ * imcdf_get_variable_attribute_string_arena
+ * imcdf_get_variable_attribute_double
+ * imcdf_get_variable_attribute_tt2000
+ *
+ * Description: get the contents of a variable attribute
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                      attr_name - the attribute name
+ *                   var_name - the name of the variable
+ *                   arena - the arena that strings are allocated from, or
+ *                           null to allocate them with malloc ()
+ * Output parameters: value - the value of the attribute - for strings
+ *                            this will point to dynamically allocated memory
+ * Returns: 0 for success, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_get_variable_attribute_string (int cdf_handle, char *attr_name, 
+                                         char *var_name, char **value)
+
+{
+    return imcdf_get_variable_attribute_string_arena (cdf_handle, attr_name, var_name, 0, value);
+}
+
+
+int imcdf_get_variable_attribute_string_arena (int cdf_handle, char *attr_name, 
+                                               char *var_name, struct IMCDFArena *arena,
+                                               char **value)
+                                         
+{                                         
+    long var_num, attr_num, data_type, num_elements;
+    
+    if (sanity_check_handles (cdf_handle)) return -1;
+
+    var_num = get_var_num (cdf_handle, var_name);
+    if (var_num < 0l)
+    {
+        cdf_status = (CDFstatus) var_num;
+        return -1;
+    }
+    
+    attr_num = get_attr_num (cdf_handle, attr_name);
+    if (attr_num < 0)
+    {
+        cdf_status = attr_num;
+        return -1;
+    }
+    
+    cdf_status = CDFinquireAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, 
+                                       &data_type, &num_elements);
+    if (cdf_status < 0) return -1;
+    if (data_type != CDF_CHAR) return -1;
+    
+    *value = arena_or_malloc (arena, num_elements +1);
+    if (! *value)
+    {
+        cdf_status = BAD_MALLOC;
+        return -1;
+    }
+    
+    cdf_status = CDFgetAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, *value);
+    if (cdf_status < 0)
+    {
+        if (! arena) free (*value);
+        return -1;
+    }
+    *((*value) + num_elements) = '\0';
+    
+    return 0;
+}
+
+
+int imcdf_get_variable_attribute_double (int cdf_handle, char *attr_name, 
+                                         char *var_name, double *value)
+                                         
 {                                         
     long var_num, attr_num, data_type, num_elements;
     
     if (sanity_check_handles (cdf_handle)) return -1;
 
-    var_num = CDFgetVarNum (cdf_ids [ cdf_handle], var_name);
+    var_num = get_var_num (cdf_handle, var_name);
     if (var_num < 0l)
     {
-        cdf_status = (CDFstatus) cdf_status;
+        cdf_status = (CDFstatus) var_num;
         return -1;
     }
     
-    attr_num = CDFattrNum (cdf_ids [cdf_handle], attr_name);
+    attr_num = get_attr_num (cdf_handle, attr_name);
     if (attr_num < 0)
     {
         cdf_status = attr_num;
         return -1;
     }
     
-    cdf_status = CDFinquireAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, 
+    cdf_status = CDFinquireAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, 
                                        &data_type, &num_elements);
     if (cdf_status < 0) return -1;
     if (data_type != CDF_DOUBLE) return -1;
     
-    cdf_status = CDFgetAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, value);
+    cdf_status = CDFgetAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, value);
     if (cdf_status < 0) return -1;
     
     return 0;
@@ -665,27 +1161,83 @@ int imcdf_get_variable_attribute_tt2000 (int cdf_handle, char *attr_name,
     
     if (sanity_check_handles (cdf_handle)) return -1;
 
-    var_num = CDFgetVarNum (cdf_ids [ cdf_handle], var_name);
+    var_num = get_var_num (cdf_handle, var_name);
     if (var_num < 0l)
     {
-        cdf_status = (CDFstatus) cdf_status;
+        cdf_status = (CDFstatus) var_num;
         return -1;
     }
     
-    attr_num = CDFattrNum (cdf_ids [cdf_handle], attr_name);
+    attr_num = get_attr_num (cdf_handle, attr_name);
     if (attr_num < 0)
     {
         cdf_status = attr_num;
         return -1;
     }
     
-    cdf_status = CDFinquireAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, 
+    cdf_status = CDFinquireAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, 
                                        &data_type, &num_elements);
     if (cdf_status < 0) return -1;
     if (data_type != CDF_TIME_TT2000) return -1;
     
-    cdf_status = CDFgetAttrzEntry (cdf_ids [cdf_handle], attr_num, var_num, value);
+    cdf_status = CDFgetAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, value);
+    if (cdf_status < 0) return -1;
+    
+    return 0;
+}
+
+/****************************************************************************
+ * imcdf_get_variable_attribute_string_into
+ *
+ * Description: get the contents of a string variable attribute into a
+ *              buffer supplied by the caller
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   attr_name - the attribute name
+ *                   var_name - the name of the variable
+ *                   capacity - the size of the value buffer, including
+ *                              space for the string terminator
+ * Output parameters: value - the value of the attribute
+ *                    length - the length of the string (excluding the
+ *                             terminator)
+ * Returns: 0 for success, 1 if the buffer is too small (in which case length
+ *          is still set), -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_get_variable_attribute_string_into (int cdf_handle, char *attr_name, 
+                                              char *var_name, char *value,
+                                              int capacity, int *length)
+                                         
+{                                         
+    long var_num, attr_num, data_type, num_elements;
+    
+    if (sanity_check_handles (cdf_handle)) return -1;
+
+    var_num = get_var_num (cdf_handle, var_name);
+    if (var_num < 0l)
+    {
+        cdf_status = (CDFstatus) var_num;
+        return -1;
+    }
+    
+    attr_num = get_attr_num (cdf_handle, attr_name);
+    if (attr_num < 0)
+    {
+        cdf_status = attr_num;
+        return -1;
+    }
+    
+    cdf_status = CDFinquireAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, 
+                                       &data_type, &num_elements);
+    if (cdf_status < 0) return -1;
+    if (data_type != CDF_CHAR) return -1;
+    
+    *length = (int) num_elements;
+    if (num_elements >= capacity) return 1;
+    
+    cdf_status = CDFgetAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, var_num, value);
     if (cdf_status < 0) return -1;
+    *(value + num_elements) = '\0';
     
     return 0;
 }
@@ -693,176 +1245,534 @@ int imcdf_get_variable_attribute_tt2000 (int cdf_handle, char *attr_name,
 /***************************************************************************
  * imcdf_get_var_data                                         
  * imcdf_get_var_time_stamp
+ * imcdf_get_var_data_arena
+ * imcdf_get_var_time_stamps_arena
  *
- * Description: get data from a data variable or a timestamp variable
+ * Description: get data from a data variable or a timestamp variable - 
+ *              records are fetched from the CDF library in blocks (see
+ *              imcdf_set_read_chunk_size) rather than one at a time
  *
  * Input parameters: cdf_handle - handle to the CDF file
  *                   name - the name of the variable
+ *                   arena - the arena that the data is allocated from, or
+ *                           null to allocate it with malloc ()
  * Output parameters: data_len - the length of the retrieved data
  * Returns: the data in a newly allocated memory space or NULL if there
  *          is a failure
  *
  ****************************************************************************/
 double *imcdf_get_var_data (int cdf_handle, char *var_name, int *data_len)
+{
+    return imcdf_get_var_data_arena (cdf_handle, var_name, 0, data_len);
+}
+
+double *imcdf_get_var_data_arena (int cdf_handle, char *var_name, struct IMCDFArena *arena,
+                                 int *data_len)
 {
 
-    long var_num, data_type, num_elements, num_dims, dim_sizes [CDF_MAX_DIMS];
-    long rec_variance, dim_variance [CDF_MAX_DIMS], count;
+    long var_num, n_recs;
     double *data;
-    char local_var_name [CDF_VAR_NAME_LEN256 +1];
 
     if (sanity_check_handles (cdf_handle)) return 0;
-
-    var_num = CDFgetVarNum (cdf_ids [cdf_handle], var_name);
-    if (var_num < 0l)
-    {
-        cdf_status = (CDFstatus) cdf_status;
-        return 0;
-    }
-    
-    cdf_status = CDFinquirezVar (cdf_ids [cdf_handle], var_num, local_var_name,
-                                 &data_type, &num_elements, &num_dims, dim_sizes,
-                                 &rec_variance, dim_variance);
-    if (cdf_status < 0) return 0;
-    if (data_type != CDF_DOUBLE) return 0;
-    if (num_dims != 0) return 0;
-    
-    cdf_status = CDFgetzVarNumRecsWritten (cdf_ids [cdf_handle], var_num, data_len);
-    if (cdf_status != CDF_OK) return 0;
+    if (check_var (cdf_handle, var_name, CDF_DOUBLE, &var_num, &n_recs)) return 0;
                                  
-    data = malloc (*data_len * sizeof (double));
+    data = arena_or_malloc (arena, (n_recs > 0 ? n_recs : 1) * sizeof (double));
     if (! data) 
     {
         cdf_status = BAD_MALLOC;
         return 0;
     }
 
-    for (count=0; count<*data_len; count++)
+    if (get_records (cdf_handle, var_num, 0l, data, n_recs, sizeof (double)))
     {
-        cdf_status = CDFgetzVarRecordData (cdf_ids [cdf_handle], var_num, count, data + count);
-        if (cdf_status < 0) 
-        {
-            free (data);
-            return 0;
-        }
+        if (! arena) free (data);
+        return 0;
     }
 
+    *data_len = (int) n_recs;
     return data;
 }
 
 
 long long *imcdf_get_var_time_stamps (int cdf_handle, char *var_name, int *data_len)
+{
+    return imcdf_get_var_time_stamps_arena (cdf_handle, var_name, 0, data_len);
+}
+
+long long *imcdf_get_var_time_stamps_arena (int cdf_handle, char *var_name, struct IMCDFArena *arena,
+                                           int *data_len)
 {
 
-    long var_num, data_type, num_elements, num_dims, dim_sizes [CDF_MAX_DIMS];
-    long rec_variance, dim_variance [CDF_MAX_DIMS], count;
+    long var_num, n_recs;
     long long *data;
-    char local_var_name [CDF_VAR_NAME_LEN256 +1];
 
     if (sanity_check_handles (cdf_handle)) return 0;
-
-    var_num = CDFgetVarNum (cdf_ids [cdf_handle], var_name);
-    if (var_num < 0l)
-    {
-        cdf_status = (CDFstatus) cdf_status;
-        return 0;
-    }
-    
-    cdf_status = CDFinquirezVar (cdf_ids [cdf_handle], var_num, local_var_name,
-                                 &data_type, &num_elements, &num_dims, dim_sizes,
-                                 &rec_variance, dim_variance);
-    if (cdf_status < 0) return 0;
-    if (data_type != CDF_TIME_TT2000) return 0;
-    if (num_dims != 0) return 0;
-    
-    cdf_status = CDFgetzVarNumRecsWritten (cdf_ids [cdf_handle], var_num, data_len);
-    if (cdf_status != CDF_OK) return 0;
+    if (check_var (cdf_handle, var_name, CDF_TIME_TT2000, &var_num, &n_recs)) return 0;
                                  
-    data = malloc (*data_len * sizeof (long long));
+    data = arena_or_malloc (arena, (n_recs > 0 ? n_recs : 1) * sizeof (long long));
     if (! data) 
     {
         cdf_status = BAD_MALLOC;
         return 0;
     }
 
-    for (count=0; count<*data_len; count++)
+    if (get_records (cdf_handle, var_num, 0l, data, n_recs, sizeof (long long)))
     {
-        cdf_status = CDFgetzVarRecordData (cdf_ids [cdf_handle], var_num, count, data + count);
-        if (cdf_status < 0) 
-        {
-            free (data);
-            return 0;
-        }
+        if (! arena) free (data);
+        return 0;
     }
 
+    *data_len = (int) n_recs;
     return data;
 }
 
 /***************************************************************************
- * imcdf_is_var_exist                                 
+ * imcdf_get_var_data_range
+ * imcdf_get_var_time_stamps_range
  *
- * Description: test if the given variable exists
+ * Description: get part of the data from a data variable or a timestamp
+ *              variable - only the requested records are read from the CDF
  *
  * Input parameters: cdf_handle - handle to the CDF file
  *                   name - the name of the variable
+ *                   first_rec - the first record to read (0 based)
+ *                   n_recs - the number of records to read - the range must
+ *                            lie within the records in the variable
  * Output parameters:
- * Returns: 0 if variable is found, -1 otherwise
+ * Returns: the data in a newly allocated memory space or NULL if there
+ *          is a failure
  *
  ****************************************************************************/
-int imcdf_is_var_exist (int cdf_handle, char *name)
+double *imcdf_get_var_data_range (int cdf_handle, char *var_name, int first_rec, int n_recs)
+{
+
+    long var_num, var_n_recs;
+    double *data;
+
+    if (sanity_check_handles (cdf_handle)) return 0;
+    if (check_var (cdf_handle, var_name, CDF_DOUBLE, &var_num, &var_n_recs)) return 0;
+    if (first_rec < 0 || n_recs < 0 || (long) first_rec + (long) n_recs > var_n_recs)
+    {
+        cdf_status = BAD_ARGUMENT;
+        return 0;
+    }
+                                 
+    data = malloc ((n_recs > 0 ? n_recs : 1) * sizeof (double));
+    if (! data) 
+    {
+        cdf_status = BAD_MALLOC;
+        return 0;
+    }
+
+    if (get_records (cdf_handle, var_num, first_rec, data, n_recs, sizeof (double)))
+    {
+        free (data);
+        return 0;
+    }
+
+    return data;
+}
+
 
+long long *imcdf_get_var_time_stamps_range (int cdf_handle, char *var_name, int first_rec, int n_recs)
 {
 
-    long var_num;
+    long var_num, var_n_recs;
+    long long *data;
 
-    var_num = CDFgetVarNum (cdf_ids [ cdf_handle], name);
-    if (var_num < 0l)
+    if (sanity_check_handles (cdf_handle)) return 0;
+    if (check_var (cdf_handle, var_name, CDF_TIME_TT2000, &var_num, &var_n_recs)) return 0;
+    if (first_rec < 0 || n_recs < 0 || (long) first_rec + (long) n_recs > var_n_recs)
     {
-        cdf_status = (CDFstatus) var_num;
-        return -1;
+        cdf_status = BAD_ARGUMENT;
+        return 0;
     }
-    return 0;
+                                 
+    data = malloc ((n_recs > 0 ? n_recs : 1) * sizeof (long long));
+    if (! data) 
+    {
+        cdf_status = BAD_MALLOC;
+        return 0;
+    }
+
+    if (get_records (cdf_handle, var_num, first_rec, data, n_recs, sizeof (long long)))
+    {
+        free (data);
+        return 0;
+    }
+
+    return data;
 }
-    
-    
-/** ------------------------------------------------------------------------
- *  ---------------------- TT2000 data manipulation ------------------------
- *  ------------------------------------------------------------------------*/
 
-/****************************************************************************
- * imcdf_date_time_to_tt2000
- * imcdf_tt2000_to_date_time
+/***************************************************************************
+ * imcdf_get_var_data_into
+ * imcdf_get_var_time_stamps_into
  *
- * Description: convert date/time to / from TT2000
+ * Description: get data from a data variable or a timestamp variable into a
+ *              buffer supplied by the caller - no memory is allocated
  *
- * Input parameters: year, month, day - the date - month and day start at 1
- *                   hour, min, sec - the time (all 0 based)
- * Output parameters: tt2000 - the output tt2000 value
- * Returns: 0 if conversion was completed OK, -1 otherwise
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   name - the name of the variable
+ *                   capacity - the number of elements the buffer can hold
+ * Output parameters: data - the data
+ *                    data_len - the length of the data in the variable
+ * Returns: 0 for success, 1 if the buffer is too small (in which case 
+ *          data_len is still set to the length needed), -1 for failure
  *
  ****************************************************************************/
-int imcdf_date_time_to_tt2000 (int year, int month, int day, int hour, 
-                               int min, int sec, long long *tt2000)
+int imcdf_get_var_data_into (int cdf_handle, char *var_name, double *data,
+                             int capacity, int *data_len)
 {
-    *tt2000 = computeTT2000 ((double) year, (double) month, (double) day,
-                             (double) hour, (double) min, (double) sec,
-                             0.0, 0.0, 0.0);
-    if (*tt2000 == ILLEGAL_TT2000_VALUE)
-    {
-        cdf_status = BAD_ARGUMENT;
-        return -1;
-    }
-    cdf_status = CDF_OK;
+
+    long var_num, n_recs;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (check_var (cdf_handle, var_name, CDF_DOUBLE, &var_num, &n_recs)) return -1;
+
+    *data_len = (int) n_recs;
+    if (n_recs > capacity) return 1;
+    if (get_records (cdf_handle, var_num, 0l, data, n_recs, sizeof (double))) return -1;
+
     return 0;
 }
 
 
-int imcdf_tt2000_to_date_time (long long tt2000, 
-                               int *year, int *month, int *day, 
-                               int *hour, int *min, int *sec)
+int imcdf_get_var_time_stamps_into (int cdf_handle, char *var_name, long long *data,
+                                    int capacity, int *data_len)
 {
-    double d_year, d_month, d_day, d_hour, d_min, d_sec;
-    
+
+    long var_num, n_recs;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (check_var (cdf_handle, var_name, CDF_TIME_TT2000, &var_num, &n_recs)) return -1;
+
+    *data_len = (int) n_recs;
+    if (n_recs > capacity) return 1;
+    if (get_records (cdf_handle, var_num, 0l, data, n_recs, sizeof (long long))) return -1;
+
+    return 0;
+}
+
+/***************************************************************************
+ * imcdf_get_var_data_range_into
+ * imcdf_get_var_time_stamps_range_into
+ *
+ * Description: get part of the data from a data variable or a timestamp
+ *              variable into a buffer supplied by the caller - no memory
+ *              is allocated
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   name - the name of the variable
+ *                   first_rec - the first record to read (0 based)
+ *                   n_recs - the number of records to read - the range must
+ *                            lie within the records in the variable and the
+ *                            buffer must be able to hold n_recs elements
+ * Output parameters: data - the data
+ * Returns: 0 for success, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_get_var_data_range_into (int cdf_handle, char *var_name, int first_rec, 
+                                   int n_recs, double *data)
+{
+
+    long var_num, var_n_recs;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (check_var (cdf_handle, var_name, CDF_DOUBLE, &var_num, &var_n_recs)) return -1;
+    if (first_rec < 0 || n_recs < 0 || (long) first_rec + (long) n_recs > var_n_recs)
+    {
+        cdf_status = BAD_ARGUMENT;
+        return -1;
+    }
+
+    return get_records (cdf_handle, var_num, first_rec, data, n_recs, sizeof (double));
+}
+
+
+int imcdf_get_var_time_stamps_range_into (int cdf_handle, char *var_name, int first_rec, 
+                                          int n_recs, long long *data)
+{
+
+    long var_num, var_n_recs;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (check_var (cdf_handle, var_name, CDF_TIME_TT2000, &var_num, &var_n_recs)) return -1;
+    if (first_rec < 0 || n_recs < 0 || (long) first_rec + (long) n_recs > var_n_recs)
+    {
+        cdf_status = BAD_ARGUMENT;
+        return -1;
+    }
+
+    return get_records (cdf_handle, var_num, first_rec, data, n_recs, sizeof (long long));
+}
+
+/***************************************************************************
+ * imcdf_find_time_stamp_range
+ *
+ * Description: find the records in a time stamp variable that lie inside
+ *              a time range - the records are located using a small number
+ *              of single record reads: if the time stamps have a regular
+ *              cadence the position is calculated directly, otherwise a
+ *              binary search of the time stamps is used
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   name - the name of the time stamp variable
+ *                   start_tt2000 - the start of the range (inclusive)
+ *                   end_tt2000 - the end of the range (inclusive)
+ * Output parameters: first_rec - the first record inside the range
+ *                    n_recs - the number of records inside the range,
+ *                             which will be 0 if no records are in range
+ * Returns: 0 for success, -1 for failure
+ *
+ ****************************************************************************/
+int imcdf_find_time_stamp_range (int cdf_handle, char *var_name, 
+                                 long long start_tt2000, long long end_tt2000,
+                                 int *first_rec, int *n_recs)
+{
+
+    long var_num, var_n_recs, first, last;
+    long long first_ts, second_ts, last_ts, step;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    if (check_var (cdf_handle, var_name, CDF_TIME_TT2000, &var_num, &var_n_recs)) return -1;
+
+    *first_rec = 0;
+    *n_recs = 0;
+    if (var_n_recs <= 0 || end_tt2000 < start_tt2000) return 0;
+
+    /* read the end points of the time stamps */
+    if (get_time_stamp (cdf_handle, var_num, 0l, &first_ts)) return -1;
+    if (get_time_stamp (cdf_handle, var_num, var_n_recs -1, &last_ts)) return -1;
+    if (start_tt2000 > last_ts || end_tt2000 < first_ts) return 0;
+    if (var_n_recs == 1)
+    {
+        *n_recs = 1;
+        return 0;
+    }
+
+    /* for a regular cadence calculate the position of the end points, then
+     * check the calculated positions against the time stamps on either side */
+    if (get_time_stamp (cdf_handle, var_num, 1l, &second_ts)) return -1;
+    step = second_ts - first_ts;
+    first = last = -1;
+    if (step > 0 && last_ts - first_ts == step * (var_n_recs -1))
+    {
+        if (start_tt2000 <= first_ts) first = 0;
+        else first = (long) ((start_tt2000 - first_ts + step -1) / step);
+        if (end_tt2000 >= last_ts) last = var_n_recs -1;
+        else last = (long) ((end_tt2000 - first_ts) / step);
+        if (check_range_boundary (cdf_handle, var_num, var_n_recs, first, start_tt2000, 1)) first = -1;
+        if (check_range_boundary (cdf_handle, var_num, var_n_recs, last, end_tt2000, 0)) last = -1;
+    }
+
+    /* otherwise search for the end points */
+    if (first < 0)
+    {
+        first = search_time_stamps (cdf_handle, var_num, var_n_recs, start_tt2000, 1);
+        if (first < -1) return -1;
+    }
+    if (last < 0)
+    {
+        last = search_time_stamps (cdf_handle, var_num, var_n_recs, end_tt2000, 0) -1;
+        if (last < -1) return -1;
+    }
+
+    if (last >= first)
+    {
+        *first_rec = (int) first;
+        *n_recs = (int) (last - first +1);
+    }
+    return 0;
+}
+
+
+/***************************************************************************
+ * imcdf_is_var_exist                                 
+ *
+ * Description: test if the given variable exists
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   name - the name of the variable
+ * Output parameters:
+ * Returns: 0 if variable is found, -1 otherwise
+ *
+ ****************************************************************************/
+int imcdf_is_var_exist (int cdf_handle, char *name)
+
+{
+
+    long var_num;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+
+    var_num = get_var_num (cdf_handle, name);
+    if (var_num < 0l)
+    {
+        cdf_status = (CDFstatus) var_num;
+        return -1;
+    }
+    return 0;
+}
+
+/*****************************************************************************
+ * imcdf_get_var_compression
+ *
+ * Description: find the compression used for a variable - this is the 
+ *              compression of the variable itself, not any compression
+ *              set for the whole file
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   name - the variable name
+ * Output parameters: compress_type - the compression
+ * Returns: 0 for success, -1 for failure
+ *
+ *****************************************************************************/
+int imcdf_get_var_compression (int cdf_handle, char *name, 
+                               enum IMCDFCompressionType *compress_type)
+
+{
+    long var_num, c_type, c_parms [CDF_MAX_PARMS], c_pct;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    var_num = get_var_num (cdf_handle, name);
+    if (var_num < 0l)
+    {
+        cdf_status = (CDFstatus) var_num;
+        return -1;
+    }
+    cdf_status = CDFgetzVarCompression (OPEN_CDF (cdf_handle).id, var_num, &c_type, c_parms, &c_pct);
+    if (cdf_status < CDF_WARN) return -1;
+
+    *compress_type = compression_type (c_type, c_parms);
+    return 0;
+}
+
+/*****************************************************************************
+ * imcdf_get_n_vars
+ *
+ * Description: find the number of variables in a CDF file
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ * Output parameters: n_vars - the number of variables
+ * Returns: 0 for success, -1 for failure
+ *
+ *****************************************************************************/
+int imcdf_get_n_vars (int cdf_handle, int *n_vars)
+
+{
+    long n;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    cdf_status = CDFgetNumzVars (OPEN_CDF (cdf_handle).id, &n);
+    if (cdf_status < CDF_WARN) return -1;
+    *n_vars = (int) n;
+    return 0;
+}
+
+/*****************************************************************************
+ * imcdf_get_var_info
+ *
+ * Description: describe a variable given its number rather than its name, 
+ *              so that all the variables in a file can be listed in one
+ *              pass - the variable's name is put in the name cache, which
+ *              makes later reads of the variable by name cheap
+ *
+ * Input parameters: cdf_handle - handle to the CDF file
+ *                   var_num - the variable number, from 0 to one less than
+ *                             the number from imcdf_get_n_vars ()
+ *                   name_len - the size of the name buffer
+ *                   depend_0_len - the size of the depend_0 buffer
+ * Output parameters: name - the variable name (truncated if it won't fit)
+ *                    data_type - the CDF data type (e.g. CDF_DOUBLE)
+ *                    n_recs - the number of records written to the variable
+ *                    depend_0 - the variable's DEPEND_0 attribute, or an
+ *                               empty string if it doesn't have one (or
+ *                               it won't fit)
+ *                    compress_type - the compression used for the variable
+ * Returns: 0 for success, -1 for failure
+ *
+ *****************************************************************************/
+int imcdf_get_var_info (int cdf_handle, int var_num, char *name, int name_len,
+                        long *data_type, int *n_recs, char *depend_0, int depend_0_len,
+                        enum IMCDFCompressionType *compress_type)
+
+{
+    long num_elements, num_dims, dim_sizes [CDF_MAX_DIMS];
+    long rec_variance, dim_variance [CDF_MAX_DIMS];
+    long n, attr_num, attr_data_type, c_type, c_parms [CDF_MAX_PARMS], c_pct;
+    char local_var_name [CDF_VAR_NAME_LEN256 +1];
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+
+    cdf_status = CDFinquirezVar (OPEN_CDF (cdf_handle).id, (long) var_num, local_var_name,
+                                 data_type, &num_elements, &num_dims, dim_sizes,
+                                 &rec_variance, dim_variance);
+    if (cdf_status < 0) return -1;
+    snprintf (name, name_len, "%s", local_var_name);
+    update_name_cache (cdf_handle, NAME_CACHE_VARIABLE, local_var_name, (long) var_num);
+
+    cdf_status = CDFgetzVarNumRecsWritten (OPEN_CDF (cdf_handle).id, (long) var_num, &n);
+    if (cdf_status != CDF_OK) return -1;
+    *n_recs = (int) n;
+
+    /* a missing DEPEND_0 is not an error - time stamp variables don't have one */
+    *depend_0 = '\0';
+    attr_num = get_attr_num (cdf_handle, "DEPEND_0");
+    if (attr_num >= 0l &&
+        CDFinquireAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, (long) var_num,
+                              &attr_data_type, &num_elements) == CDF_OK &&
+        attr_data_type == CDF_CHAR && num_elements < depend_0_len)
+    {
+        cdf_status = CDFgetAttrzEntry (OPEN_CDF (cdf_handle).id, attr_num, (long) var_num, depend_0);
+        if (cdf_status < 0) return -1;
+        *(depend_0 + num_elements) = '\0';
+    }
+
+    cdf_status = CDFgetzVarCompression (OPEN_CDF (cdf_handle).id, (long) var_num, &c_type, c_parms, &c_pct);
+    if (cdf_status < CDF_WARN) return -1;
+    *compress_type = compression_type (c_type, c_parms);
+    return 0;
+}
+    
+    
+/** ------------------------------------------------------------------------
+ *  ---------------------- TT2000 data manipulation ------------------------
+ *  ------------------------------------------------------------------------*/
+
+/****************************************************************************
+ * imcdf_date_time_to_tt2000
+ * imcdf_tt2000_to_date_time
+ *
+ * Description: convert date/time to / from TT2000
+ *
+ * Input parameters: year, month, day - the date - month and day start at 1
+ *                   hour, min, sec - the time (all 0 based)
+ * Output parameters: tt2000 - the output tt2000 value
+ * Returns: 0 if conversion was completed OK, -1 otherwise
+ *
+ ****************************************************************************/
+int imcdf_date_time_to_tt2000 (int year, int month, int day, int hour, 
+                               int min, int sec, long long *tt2000)
+{
+    *tt2000 = computeTT2000 ((double) year, (double) month, (double) day,
+                             (double) hour, (double) min, (double) sec,
+                             0.0, 0.0, 0.0);
+    if (*tt2000 == ILLEGAL_TT2000_VALUE)
+    {
+        cdf_status = BAD_ARGUMENT;
+        return -1;
+    }
+    cdf_status = CDF_OK;
+    return 0;
+}
+
+
+int imcdf_tt2000_to_date_time (long long tt2000, 
+                               int *year, int *month, int *day, 
+                               int *hour, int *min, int *sec)
+{
+    double d_year, d_month, d_day, d_hour, d_min, d_sec;
+    
     breakdownTT2000 (tt2000, &d_year, &d_month, &d_day,
                      &d_hour, &d_min, &d_sec, TT2000NULL);
     *year = (int) d_year;
@@ -896,7 +1806,11 @@ long long imcdf_tt2000_inc (long long tt2000, int inc)
 /****************************************************************************
  * imcdf_make_tt2000_array
  *
- * Description: create an array of TT2000 time stamps
+ * Description: create an array of TT2000 time stamps on a regular UTC grid - 
+ *              TT2000 counts leap seconds, so where the array spans a leap
+ *              second the TT2000 values jump by an extra second to keep the
+ *              time stamps aligned with UTC. The array is filled in runs
+ *              between leap seconds, each calculated from a single value
  *
  * Input parameters: year, month, day - the date - month and day start at 1
  *                   hour, min, sec - the time (all 0 based)
@@ -914,11 +1828,12 @@ long long *imcdf_make_tt2000_array (int year, int month, int day, int hour, int
                                     int increment, int n_samples)
 
 {
-    int count;
-    long long *tt2000_array, tt2000;
+    int count, leap_count, leap_offset, run_end, s_day, s_month, s_year;
+    long start_day, start_secs;
+    long long *tt2000_array, tt2000, run_start, step, boundary, utc_secs;
 
     
-    tt2000_array = malloc (sizeof (long long) * n_samples);
+    tt2000_array = malloc (sizeof (long long) * (n_samples > 0 ? n_samples : 1));
     if (! tt2000_array) return 0;
 
     if (imcdf_date_time_to_tt2000 (year, month, day, hour, min, sec, &tt2000))
@@ -927,10 +1842,61 @@ long long *imcdf_make_tt2000_array (int year, int month, int day, int hour, int
         return 0;
     }
     
-    for (count=0; count<n_samples; count++)
+    step = (long long) increment * 1000000000ll;
+    if (increment <= 0)
+    {
+        /* going backwards or standing still - don't adjust for leap seconds */
+        for (count=0; count<n_samples; count++)
+            *(tt2000_array + count) = tt2000 + ((long long) count * step);
+        return tt2000_array;
+    }
+
+    load_leap_seconds ();
+    start_day = days_from_civil (year, month, day);
+    start_secs = ((long) hour * 3600l) + ((long) min * 60l) + (long) sec;
+    if (n_leap_seconds <= 0 || start_day < leap_second_days [0])
+    {
+        /* before 1972 the offset from UTC isn't a whole number of seconds,
+         * so calculate each time stamp from the calendar */
+        for (count=0; count<n_samples; count++)
+        {
+            utc_secs = (long long) start_secs + ((long long) count * increment);
+            civil_from_days (start_day + (long) (utc_secs / 86400ll), &s_year, &s_month, &s_day);
+            utc_secs %= 86400ll;
+            if (imcdf_date_time_to_tt2000 (s_year, s_month, s_day, (int) (utc_secs / 3600ll),
+                                           (int) ((utc_secs % 3600ll) / 60ll), (int) (utc_secs % 60ll),
+                                           tt2000_array + count))
+            {
+                free (tt2000_array);
+                return 0;
+            }
+        }
+        return tt2000_array;
+    }
+
+    /* fill the array in runs between leap seconds */
+    leap_offset = 0;
+    count = 0;
+    for (leap_count=0; count<n_samples; leap_count++)
     {
-        *(tt2000_array + count) = tt2000;
-        tt2000 = imcdf_tt2000_inc (tt2000, increment);
+        /* find the first sample after the next leap second */
+        while (leap_count < n_leap_seconds && leap_second_days [leap_count] <= start_day)
+            leap_count ++;
+        if (leap_count < n_leap_seconds)
+        {
+            boundary = ((long long) (leap_second_days [leap_count] - start_day) * 86400ll) - start_secs;
+            boundary = (boundary + increment -1) / increment;
+            run_end = boundary < (long long) n_samples ? (int) boundary : n_samples;
+        }
+        else
+            run_end = n_samples;
+
+        run_start = tt2000 + ((long long) leap_offset * 1000000000ll);
+        for (; count<run_end; count++)
+            tt2000_array [count] = run_start + ((long long) count * step);
+
+        if (leap_count < n_leap_seconds)
+            leap_offset = leap_second_values [leap_count] - leap_seconds_at_day (start_day);
     }
     
     return tt2000_array;
@@ -961,75 +1927,351 @@ int imcdf_calc_samp_per_from_tt2000 (long long *tt2000_array)
 
 /****************************************************************************
  * imcdf_tt2000_tostring
+ * imcdf_tt2000_tostring_r
  *
  * Description: format a TT2000 object as a string
  *
  * Input parameters: tt2000 - the date/time object to format
+ *                   buffer - for imcdf_tt2000_tostring_r, space for the
+ *                            string, at least IMCDF_TT2000_STRING_LEN long
  * Output parameters: none
  * Returns: an ISO format date/time string
  *
- * The return points to a static buffer which will be overwritten on each
- * call to this function
+ * For imcdf_tt2000_tostring the return points to a buffer which will be 
+ * overwritten on each call to this function from the same thread
  ****************************************************************************/
 char *imcdf_tt2000_tostring (long long tt2000)
 
 {
 
-  static char buffer [30];
+  static IMCDF_THREAD_LOCAL char buffer [IMCDF_TT2000_STRING_LEN];
 
-  encodeTT2000 (tt2000, buffer, 3);
-  buffer [19] = '\0';
-  return buffer;
+  return imcdf_tt2000_tostring_r (tt2000, buffer);
 
 }
 
 
-/** ------------------------------------------------------------------------
- *  --------------------------- Error notification -------------------------
- *  ------------------------------------------------------------------------*/
- 
-/*****************************************************************************
- * imcdf_get_last_status_code
- *
- * Description: get the status code (which may have been successful) from
- *              the last call to the CDF library
- *
- * Input parameters:
- * Output parameters:
- * Returns: the status code
- *
- *****************************************************************************/
-CDFstatus imcdf_get_last_status_code ()
+char *imcdf_tt2000_tostring_r (long long tt2000, char *buffer)
 
 {
-    return cdf_status;
+
+  encodeTT2000 (tt2000, buffer, 3);
+  buffer [19] = '\0';
+  return buffer;
+
 }
 
-/*****************************************************************************
- * imcdf_status_code_tostring
+
+/****************************************************************************
+ * imcdf_tt2000_to_date_time_array
+ * imcdf_tt2000_to_string_array
  *
- * Description: decode a CDF status code to something that can be displayed to
- *              a user
+ * Description: convert an array of TT2000 time stamps to broken down dates /
+ *              times or to strings - the strings are the same as calling
+ *              imcdf_tt2000_tostring () for each sample. Fractions of a
+ *              second are truncated, as they are in those strings - unlike
+ *              imcdf_tt2000_to_date_time (), which rounds to the nearest
+ *              second. The calendar is only calculated once per day,
+ *              times within the day being derived from the offset from the
+ *              start of the day. Days containing a leap second are handled.
+ *              Time stamps may be in any order, but the conversion is
+ *              fastest when they are sorted
  *
- * Input parameters: status - the status code
- * Output parameters:
- * Returns: the status code (in a static buffer - a call to this function
- *          will change the contents returned from any previous calls)
+ * Input parameters: tt2000_array - the time stamps to convert
+ *                   n_samples - the number of time stamps
+ * Output parameters: date_times - for imcdf_tt2000_to_date_time_array, an
+ *                                 array of n_samples broken down times
+ *                    strings - for imcdf_tt2000_to_string_array, space for
+ *                              n_samples strings, each of 
+ *                              IMCDF_TT2000_STRING_LEN bytes - string n
+ *                              starts at (strings + (n * IMCDF_TT2000_STRING_LEN))
+ * Returns: 0 if conversion was completed OK, -1 otherwise
  *
- *****************************************************************************/
-char *imcdf_status_code_tostring (CDFstatus status)
+ ****************************************************************************/
+int imcdf_tt2000_to_date_time_array (long long *tt2000_array, int n_samples,
+                                     struct IMCDFDateTime *date_times)
 
 {
-    char cdf_msg[CDF_STATUSTEXT_LEN+1];
+    int count, sec_of_day;
+    long long day_start, day_end;
+    struct IMCDFDateTime day_date, *date_time;
 
-    static char message[CDF_STATUSTEXT_LEN+30];
-
-    if (status < CDF_WARN) 
-    {
-        CDFgetStatusText (status, cdf_msg);
-        sprintf (message, "Error: %s\n", cdf_msg);
-    }
-    else if (status < CDF_OK) 
+    day_start = day_end = 0;
+    for (count=0; count<n_samples; count++)
+    {
+        date_time = date_times + count;
+        if (tt2000_array [count] < day_start || tt2000_array [count] >= day_end)
+        {
+            if (! find_day (tt2000_array [count], &day_date, &day_start, &day_end))
+            {
+                /* not a day that can be calculated from its start */
+                imcdf_tt2000_to_date_time (tt2000_array [count], &date_time->year,
+                                           &date_time->month, &date_time->day,
+                                           &date_time->hour, &date_time->min,
+                                           &date_time->sec);
+                continue;
+            }
+        }
+        
+        sec_of_day = (int) ((tt2000_array [count] - day_start) / 1000000000ll);
+        *date_time = day_date;
+        if (sec_of_day >= 86400)
+        {
+            date_time->hour = 23;
+            date_time->min = 59;
+            date_time->sec = sec_of_day - 86340;
+        }
+        else
+        {
+            date_time->hour = sec_of_day / 3600;
+            date_time->min = (sec_of_day / 60) % 60;
+            date_time->sec = sec_of_day % 60;
+        }
+    }
+
+    cdf_status = CDF_OK;
+    return 0;
+}
+
+
+int imcdf_tt2000_to_string_array (long long *tt2000_array, int n_samples,
+                                  char *strings)
+
+{
+    int count, sec_of_day, hour, min, sec;
+    long long day_start, day_end;
+    char *string, date_string [12];
+    struct IMCDFDateTime day_date;
+
+    day_start = day_end = 0;
+    date_string [0] = '\0';
+    for (count=0; count<n_samples; count++)
+    {
+        string = strings + ((size_t) count * IMCDF_TT2000_STRING_LEN);
+        if (tt2000_array [count] < day_start || tt2000_array [count] >= day_end)
+        {
+            if (! find_day (tt2000_array [count], &day_date, &day_start, &day_end))
+            {
+                imcdf_tt2000_tostring_r (tt2000_array [count], string);
+                continue;
+            }
+            put_digits (date_string, day_date.year, 4);
+            date_string [4] = '-';
+            put_digits (date_string + 5, day_date.month, 2);
+            date_string [7] = '-';
+            put_digits (date_string + 8, day_date.day, 2);
+            date_string [10] = 'T';
+        }
+
+        sec_of_day = (int) ((tt2000_array [count] - day_start) / 1000000000ll);
+        if (sec_of_day >= 86400)
+        {
+            hour = 23;
+            min = 59;
+            sec = sec_of_day - 86340;
+        }
+        else
+        {
+            hour = sec_of_day / 3600;
+            min = (sec_of_day / 60) % 60;
+            sec = sec_of_day % 60;
+        }
+        memcpy (string, date_string, 11);
+        put_digits (string + 11, hour, 2);
+        string [13] = ':';
+        put_digits (string + 14, min, 2);
+        string [16] = ':';
+        put_digits (string + 17, sec, 2);
+        string [19] = '\0';
+    }
+
+    cdf_status = CDF_OK;
+    return 0;
+}
+
+
+/** ------------------------------------------------------------------------
+ *  ------------------------- Arena memory allocation ----------------------
+ *  ------------------------------------------------------------------------*/
+
+/*****************************************************************************
+ * imcdf_arena_init
+ *
+ * Description: set up an arena - no memory is allocated until the first
+ *              call to imcdf_arena_alloc ()
+ *
+ * Input parameters: arena - the arena
+ *                   block_size - the size of each block of memory, 0 for 
+ *                                the default (IMCDF_ARENA_BLOCK_SIZE)
+ * Output parameters: none
+ * Returns: none
+ *
+ *****************************************************************************/
+void imcdf_arena_init (struct IMCDFArena *arena, size_t block_size)
+
+{
+    arena->first = arena->current = 0;
+    arena->block_size = block_size > 0 ? block_size : IMCDF_ARENA_BLOCK_SIZE;
+}
+
+/*****************************************************************************
+ * imcdf_arena_alloc
+ *
+ * Description: allocate memory from an arena - the memory is aligned to 
+ *              IMCDF_ARENA_ALIGN bytes and can't be freed on its own. Requests
+ *              larger than the block size are given a block of their own
+ *
+ * Input parameters: arena - the arena
+ *                   size - the number of bytes needed
+ * Output parameters: none
+ * Returns: the memory or null if there is no more memory
+ *
+ *****************************************************************************/
+void *imcdf_arena_alloc (struct IMCDFArena *arena, size_t size)
+
+{
+    size_t header_size;
+    struct IMCDFArenaBlock *block, *last;
+
+    header_size = ARENA_ROUND (sizeof (struct IMCDFArenaBlock));
+    size = ARENA_ROUND (size > 0 ? size : 1);
+
+    /* use the first block from the current one that has room - after
+     * imcdf_arena_reset () the blocks are reused in order */
+    for (block = arena->current, last = 0; block; last = block, block = block->next)
+    {
+        if (block->size - block->used >= size)
+        {
+            arena->current = block;
+            block->used += size;
+            return (char *) block + header_size + block->used - size;
+        }
+    }
+
+    block = malloc (header_size + (size > arena->block_size ? size : arena->block_size));
+    if (! block) return 0;
+    block->next = 0;
+    block->size = size > arena->block_size ? size : arena->block_size;
+    block->used = size;
+    if (last) last->next = block;
+    else arena->first = block;
+    arena->current = block;
+    return (char *) block + header_size;
+}
+
+/*****************************************************************************
+ * imcdf_arena_reset
+ * imcdf_arena_free
+ *
+ * Description: release all the memory allocated from an arena - reset keeps
+ *              the memory so it can be used again without going back to 
+ *              malloc (), free returns it to the system. When reset finds
+ *              the memory spread over several blocks it replaces them with
+ *              one block of the same total size, so an arena that is reset
+ *              and filled again in the same way (e.g. reading one file
+ *              after another) soon stops calling malloc () at all
+ *
+ * Input parameters: arena - the arena
+ * Output parameters: none
+ * Returns: none
+ *
+ *****************************************************************************/
+void imcdf_arena_reset (struct IMCDFArena *arena)
+
+{
+    size_t size;
+    struct IMCDFArenaBlock *block, *merged;
+
+    if (arena->first && arena->first->next)
+    {
+        for (block = arena->first, size = 0; block; block = block->next)
+            size += block->size;
+        merged = malloc (ARENA_ROUND (sizeof (struct IMCDFArenaBlock)) + size);
+        if (merged)
+        {
+            imcdf_arena_free (arena);
+            merged->next = 0;
+            merged->size = size;
+            arena->first = merged;
+        }
+    }
+
+    for (block = arena->first; block; block = block->next)
+        block->used = 0;
+    arena->current = arena->first;
+}
+
+void imcdf_arena_free (struct IMCDFArena *arena)
+
+{
+    struct IMCDFArenaBlock *block, *next;
+
+    for (block = arena->first; block; block = next)
+    {
+        next = block->next;
+        free (block);
+    }
+    arena->first = arena->current = 0;
+}
+
+
+/** ------------------------------------------------------------------------
+ *  --------------------------- Error notification -------------------------
+ *  ------------------------------------------------------------------------*/
+ 
+/*****************************************************************************
+ * imcdf_get_last_status_code
+ *
+ * Description: get the status code (which may have been successful) from
+ *              the last call to the CDF library made by the calling thread
+ *
+ * Input parameters:
+ * Output parameters:
+ * Returns: the status code
+ *
+ *****************************************************************************/
+CDFstatus imcdf_get_last_status_code ()
+
+{
+    return cdf_status;
+}
+
+/*****************************************************************************
+ * imcdf_status_code_tostring
+ * imcdf_status_code_tostring_r
+ *
+ * Description: decode a CDF status code to something that can be displayed to
+ *              a user
+ *
+ * Input parameters: status - the status code
+ *                   message - for imcdf_status_code_tostring_r, space for
+ *                             the message, at least IMCDF_STATUS_STRING_LEN long
+ * Output parameters:
+ * Returns: the status code (for imcdf_status_code_tostring in a buffer held
+ *          by the calling thread - a call to this function will change the 
+ *          contents returned from any previous calls in the same thread)
+ *
+ *****************************************************************************/
+char *imcdf_status_code_tostring (CDFstatus status)
+
+{
+    static IMCDF_THREAD_LOCAL char message[IMCDF_STATUS_STRING_LEN];
+
+    return imcdf_status_code_tostring_r (status, message);
+}
+
+
+char *imcdf_status_code_tostring_r (CDFstatus status, char *message)
+
+{
+    char cdf_msg[CDF_STATUSTEXT_LEN+1];
+
+    if (status < CDF_WARN) 
+    {
+        CDFgetStatusText (status, cdf_msg);
+        sprintf (message, "Error: %s\n", cdf_msg);
+    }
+    else if (status < CDF_OK) 
     {
         CDFgetStatusText (status, cdf_msg);
         sprintf (message, "Warning: %s\n", cdf_msg);
@@ -1052,41 +2294,450 @@ char *imcdf_status_code_tostring (CDFstatus status)
  *  ---------------------------- Private code ------------------------------
  *  ------------------------------------------------------------------------*/
 
-/* initialise the array of CDF ids */
-static void initialise_cdf_ids ()
+/* find a free entry in the table of open CDFs and reserve it, taking it 
+ * from the free list or from the end of the table - returns a handle for
+ * the entry or -1 if the table is full or out of memory */
+static int reserve_open_cdf ()
 {
-    int count;
+    int index;
+    struct OpenCDF *page;
     
-    if (cdf_index < 0)
+    pthread_mutex_lock (&open_cdfs_lock);
+    if (open_cdf_free_list >= 0)
     {
-        for (count=0; count<MAX_OPEN_CDF_FILES; count++)
-            cdf_ids [count] = (CDFid) 0;
-        cdf_index = 0;
-        
-        cdf_status = CDF_OK;
+        index = open_cdf_free_list;
+        open_cdf_free_list = OPEN_CDF (index).next_free;
+        if (open_cdf_free_list < 0) open_cdf_free_tail = -1;
+    }
+    else
+    {
+        if (n_open_cdf_entries >= MAX_OPEN_CDF_FILES)
+        {
+            pthread_mutex_unlock (&open_cdfs_lock);
+            return -1;
+        }
+        index = n_open_cdf_entries;
+        if (! open_cdf_pages [index / OPEN_CDF_PAGE_SIZE])
+        {
+            page = calloc (OPEN_CDF_PAGE_SIZE, sizeof (struct OpenCDF));
+            if (! page)
+            {
+                pthread_mutex_unlock (&open_cdfs_lock);
+                cdf_status = BAD_MALLOC;
+                return -1;
+            }
+            open_cdf_pages [index / OPEN_CDF_PAGE_SIZE] = page;
+        }
+        n_open_cdf_entries ++;
     }
+    OPEN_CDF (index).state = OPEN_CDF_RESERVED;
+    pthread_mutex_unlock (&open_cdfs_lock);
+    return MAKE_HANDLE (index, OPEN_CDF (index).generation);
+}
+
+/* return an entry in the table of open CDFs to the tail of the free list -
+ * changing the generation makes any copies of the handle invalid */
+static void release_open_cdf (int cdf_handle)
+{
+    pthread_mutex_lock (&open_cdfs_lock);
+    OPEN_CDF (cdf_handle).state = OPEN_CDF_FREE;
+    OPEN_CDF (cdf_handle).generation = (OPEN_CDF (cdf_handle).generation +1) & HANDLE_GENERATION_MASK;
+    OPEN_CDF (cdf_handle).next_free = -1;
+    if (open_cdf_free_tail >= 0)
+        OPEN_CDF (open_cdf_free_tail).next_free = HANDLE_INDEX (cdf_handle);
+    else
+        open_cdf_free_list = HANDLE_INDEX (cdf_handle);
+    open_cdf_free_tail = HANDLE_INDEX (cdf_handle);
+    pthread_mutex_unlock (&open_cdfs_lock);
 }
 
 /* code used at the start of each function to check sanity of the
- * state of the cdf handles */
+ * state of the cdf handles - the lock isn't needed here, as only the 
+ * thread that owns a handle can open or close it */
 static int sanity_check_handles (int cdf_handle)
 {
-    initialise_cdf_ids ();
     if (cdf_handle < 0) return -1;
-    if (cdf_handle >= cdf_index) return -1;
+    if (! open_cdf_pages [HANDLE_INDEX (cdf_handle) / OPEN_CDF_PAGE_SIZE]) return -1;
+    if (OPEN_CDF (cdf_handle).state != OPEN_CDF_OPEN) return -1;
+    if (OPEN_CDF (cdf_handle).generation != HANDLE_GENERATION (cdf_handle)) return -1;
     return 0;
 }
  
+/* convert a compression type to the parameters needed by the CDF library -
+ * returns 1 if the data should be compressed, 0 if not */
+static int compression_params (enum IMCDFCompressionType compress_type, 
+                               long *c_type, long *c_parms)
+{
+    switch (compress_type)
+    {
+    case IMCDF_COMPRESS_RLE:
+        *c_type = RLE_COMPRESSION;
+        c_parms [0] = RLE_OF_ZEROs;
+        return 1;
+    case IMCDF_COMPRESS_HUFF:
+        *c_type = HUFF_COMPRESSION;
+        c_parms [0] = OPTIMAL_ENCODING_TREES;
+        return 1;
+    case IMCDF_COMPRESS_AHUFF:
+        *c_type = AHUFF_COMPRESSION;
+        c_parms [0] = OPTIMAL_ENCODING_TREES;
+        return 1;
+    case IMCDF_COMPRESS_GZIP1:
+    case IMCDF_COMPRESS_GZIP2:
+    case IMCDF_COMPRESS_GZIP3:
+    case IMCDF_COMPRESS_GZIP4:
+    case IMCDF_COMPRESS_GZIP5:
+    case IMCDF_COMPRESS_GZIP6:
+    case IMCDF_COMPRESS_GZIP7:
+    case IMCDF_COMPRESS_GZIP8:
+    case IMCDF_COMPRESS_GZIP9:
+        *c_type = GZIP_COMPRESSION;
+        c_parms [0] = (long) (compress_type - IMCDF_COMPRESS_GZIP1) +1l;
+        return 1;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/* convert a CDF compression type and its parameters to the ImagCDF
+ * compression type */
+static enum IMCDFCompressionType compression_type (long c_type, long *c_parms)
+{
+    switch (c_type)
+    {
+    case RLE_COMPRESSION:
+        return IMCDF_COMPRESS_RLE;
+    case HUFF_COMPRESSION:
+        return IMCDF_COMPRESS_HUFF;
+    case AHUFF_COMPRESSION:
+        return IMCDF_COMPRESS_AHUFF;
+    case GZIP_COMPRESSION:
+        if (c_parms [0] < 1l || c_parms [0] > 9l) return IMCDF_COMPRESS_GZIP5;
+        return (enum IMCDFCompressionType) (IMCDF_COMPRESS_GZIP1 + (c_parms [0] -1l));
+    }
+    return IMCDF_COMPRESS_NONE;
+}
+
+/* create a variable, setting its compression and blocking factor - the
+ * data is only used to choose the compression */
+static int create_var (int cdf_handle, char *name, long data_type, void *data,
+                       int data_length, struct IMCDFVarOptions *options)
+{
+    long var_num, dim_size [1], dim_var [1], c_type, c_parms [CDF_MAX_PARMS], blocking_factor;
+    long n_recs;
+    enum IMCDFCompressionType compress_type;
+    struct IMCDFVarOptions default_options;
+
+    if (! options)
+    {
+        imcdf_init_var_options (&default_options);
+        options = &default_options;
+    }
+    n_recs = data_length > options->expected_records ? data_length : options->expected_records;
+
+    dim_size [0] = 1;
+    dim_var [0] = VARY;
+    cdf_status = CDFcreatezVar (OPEN_CDF (cdf_handle).id, name, data_type,
+                1l, 0l, dim_size, VARY, dim_var, &var_num);
+    if (cdf_status < CDF_WARN) return -1;
+    update_name_cache (cdf_handle, NAME_CACHE_VARIABLE, name, var_num);
+
+    /* variables that aren't compressed here are still compressed if 
+     * compression was set for the whole file in imcdf_open () */
+    compress_type = options->compress_type;
+    if (compress_type == IMCDF_COMPRESS_AUTO)
+        compress_type = choose_compression (data_type, data, data_length, 
+                                            options->auto_cpu_budget);
+    options->compress_type_used = compress_type;
+    if (compression_params (compress_type, &c_type, c_parms))
+    {
+        cdf_status = CDFsetzVarCompression (OPEN_CDF (cdf_handle).id, var_num, c_type, c_parms);
+        if (cdf_status < CDF_WARN) return -1;
+    }
+
+    /* a day of minute data fits in a single block, longer variables are
+     * divided into blocks so that parts of them can be read without 
+     * decompressing everything */
+    if (options->blocking_factor > 0)
+        blocking_factor = options->blocking_factor;
+    else if (n_recs > 0 && n_recs <= IMCDF_SINGLE_BLOCK_MAX_RECORDS)
+        blocking_factor = n_recs;
+    else
+        blocking_factor = IMCDF_DEFAULT_BLOCKING_FACTOR;
+    cdf_status = CDFsetzVarBlockingFactor (OPEN_CDF (cdf_handle).id, var_num, blocking_factor);
+    if (cdf_status < CDF_WARN) return -1;
+
+    return allocate_records (cdf_handle, var_num, n_recs);
+}
+
+/* choose the compression for a variable by writing a sample of its data to
+ * a scratch CDF with each type of compression in turn, cheapest first, until
+ * the CPU budget is used up - returns the type that gave the smallest file,
+ * or IMCDF_COMPRESS_INHERIT if no choice could be made */
+static enum IMCDFCompressionType choose_compression (long data_type, void *data, 
+                                                     int data_length, int cpu_budget)
+{
+    static enum IMCDFCompressionType candidates [] = 
+        {IMCDF_COMPRESS_NONE, IMCDF_COMPRESS_RLE, IMCDF_COMPRESS_HUFF,
+         IMCDF_COMPRESS_GZIP1, IMCDF_COMPRESS_GZIP6, IMCDF_COMPRESS_AHUFF,
+         IMCDF_COMPRESS_GZIP9};
+    int count, fd;
+    long n_recs, size, best_size;
+    char *tmp_dir, lock_name [200], filename [210];
+    double start;
+    enum IMCDFCompressionType best;
+
+    if (! data || data_length <= 0) return IMCDF_COMPRESS_INHERIT;
+    n_recs = data_length < IMCDF_AUTO_SAMPLE_RECORDS ? data_length : IMCDF_AUTO_SAMPLE_RECORDS;
+    if (cpu_budget <= 0) cpu_budget = IMCDF_DEFAULT_AUTO_CPU_BUDGET;
+
+    /* create a unique name for the scratch file - the file created by 
+     * mkstemp () reserves the name while the scratch CDF is in use */
+    tmp_dir = getenv ("TMPDIR");
+    if (! tmp_dir) tmp_dir = "/tmp";
+    snprintf (lock_name, sizeof (lock_name), "%s/imcdfXXXXXX", tmp_dir);
+    fd = mkstemp (lock_name);
+    if (fd < 0) return IMCDF_COMPRESS_INHERIT;
+    close (fd);
+    snprintf (filename, sizeof (filename), "%s.cdf", lock_name);
+
+    best = IMCDF_COMPRESS_INHERIT;
+    best_size = -1l;
+    start = thread_cpu_msec ();
+    for (count=0; count<(int) (sizeof (candidates) / sizeof (candidates [0])); count++)
+    {
+        if (count > 1 && thread_cpu_msec () - start > (double) cpu_budget) break;
+        size = trial_compression (filename, candidates [count], data_type, data, n_recs);
+        if (size >= 0l && (best_size < 0l || size < best_size))
+        {
+            best = candidates [count];
+            best_size = size;
+        }
+    }
+
+    remove (lock_name);
+    return best;
+}
+
+/* the CPU time used by the calling thread in milliseconds - clock () can't
+ * be used as it counts the time of every thread in the process. Falls back
+ * to elapsed time if the thread's CPU clock isn't available */
+static double thread_cpu_msec ()
+{
+    struct timespec now;
+
+    if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &now))
+        clock_gettime (CLOCK_MONOTONIC, &now);
+    return ((double) now.tv_sec * 1000.0) + ((double) now.tv_nsec / 1000000.0);
+}
+
+/* write records to a scratch CDF with the given compression and return the
+ * size of the file, or -1 if the file couldn't be written */
+static long trial_compression (char *filename, enum IMCDFCompressionType compress_type,
+                               long data_type, void *data, long n_recs)
+{
+    long var_num, dim_size [1], dim_var [1], c_type, c_parms [CDF_MAX_PARMS];
+    long indices [1], counts [1], intervals [1];
+    CDFid id;
+    struct stat stat_buf;
+
+    if (! access (filename, 0)) remove (filename);
+    cdf_status = CDFcreateCDF (filename, &id);
+    if (cdf_status < CDF_WARN) return -1l;
+
+    dim_size [0] = 1;
+    dim_var [0] = VARY;
+    indices [0] = 0l;
+    counts [0] = 1l;
+    intervals [0] = 1l;
+    cdf_status = CDFcreatezVar (id, "Trial", data_type, 1l, 0l, dim_size, VARY, dim_var, &var_num);
+    if (cdf_status >= CDF_WARN && compression_params (compress_type, &c_type, c_parms))
+        cdf_status = CDFsetzVarCompression (id, var_num, c_type, c_parms);
+    if (cdf_status >= CDF_WARN)
+        cdf_status = CDFsetzVarBlockingFactor (id, var_num, n_recs);
+    if (cdf_status >= CDF_WARN)
+        cdf_status = CDFhyperPutzVarData (id, var_num, 0l, n_recs, 1l, 
+                                          indices, counts, intervals, data);
+    if (cdf_status < CDF_WARN)
+    {
+        CDFcloseCDF (id);
+        remove (filename);
+        return -1l;
+    }
+    cdf_status = CDFcloseCDF (id);
+    if (cdf_status < CDF_WARN || stat (filename, &stat_buf))
+    {
+        remove (filename);
+        return -1l;
+    }
+    remove (filename);
+    return (long) stat_buf.st_size;
+}
+
+/* allocate space for the records in a variable before they are written, so 
+ * that the CDF library can store them contiguously - compressed variables
+ * are written a block at a time, so space for them can't be allocated */
+static int allocate_records (int cdf_handle, long var_num, long n_recs)
+{
+    long c_type, c_parms [CDF_MAX_PARMS], c_pct;
+
+    if (n_recs <= 0) return 0;
+    cdf_status = CDFgetzVarCompression (OPEN_CDF (cdf_handle).id, var_num, &c_type, c_parms, &c_pct);
+    if (cdf_status < CDF_WARN) return -1;
+    if (c_type != NO_COMPRESSION) return 0;
+    cdf_status = CDFsetzVarAllocRecords (OPEN_CDF (cdf_handle).id, var_num, n_recs);
+    if (cdf_status < CDF_WARN) return -1;
+    return 0;
+}
+
+/* load the leap second table from the CDF library - called once only */
+static void read_leap_seconds ()
+{
+    int n_rows, count;
+    double **table;
+
+    n_rows = CDFgetRowsinLeapSecondsTable ();
+    if (n_rows <= 0) return;
+    table = malloc (sizeof (double *) * n_rows);
+    if (! table) return;
+    for (count=0; count<n_rows; count++)
+    {
+        table [count] = malloc (sizeof (double) * 6);
+        if (! table [count])
+        {
+            while (count > 0) free (table [-- count]);
+            free (table);
+            return;
+        }
+    }
+    CDFfillLeapSecondsTable (table);
+
+    leap_second_days = malloc (sizeof (long) * n_rows);
+    leap_second_values = malloc (sizeof (int) * n_rows);
+    if (leap_second_days && leap_second_values)
+    {
+        for (count=0; count<n_rows; count++)
+        {
+            if (table [count] [0] < LEAP_SECONDS_START_YEAR) continue;
+            leap_second_days [n_leap_seconds] = days_from_civil ((long) table [count] [0],
+                                                                 (int) table [count] [1],
+                                                                 (int) table [count] [2]);
+            leap_second_values [n_leap_seconds] = (int) (table [count] [3] + 0.5);
+            n_leap_seconds ++;
+        }
+    }
+
+    for (count=0; count<n_rows; count++) free (table [count]);
+    free (table);
+}
+
+/* make sure the leap second table has been loaded */
+static void load_leap_seconds ()
+{
+    pthread_once (&leap_seconds_once, read_leap_seconds);
+}
+
+/* find the offset between TAI and UTC (in seconds) on a day - the table
+ * must have been loaded */
+static int leap_seconds_at_day (long day)
+{
+    int low, high, mid;
+
+    if (n_leap_seconds <= 0 || day < leap_second_days [0]) return 0;
+    low = 0;
+    high = n_leap_seconds -1;
+    while (low < high)
+    {
+        mid = (low + high +1) / 2;
+        if (leap_second_days [mid] <= day) low = mid;
+        else high = mid -1;
+    }
+    return leap_second_values [low];
+}
+
+/* convert a date to a day number, counting from 1970-01-01, and back */
+static long days_from_civil (long year, int month, int day)
+{
+    long era, yoe, doy, doe;
+
+    if (month <= 2) year --;
+    era = (year >= 0 ? year : year - 399) / 400;
+    yoe = year - (era * 400);
+    doy = ((153l * (month > 2 ? month - 3 : month + 9)) + 2) / 5 + day - 1;
+    doe = (yoe * 365) + (yoe / 4) - (yoe / 100) + doy;
+    return (era * 146097l) + doe - 719468l;
+}
+
+static void civil_from_days (long days, int *year, int *month, int *day)
+{
+    long era, doe, yoe, doy, mp;
+
+    days += 719468l;
+    era = (days >= 0 ? days : days - 146096l) / 146097l;
+    doe = days - (era * 146097l);
+    yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365;
+    doy = doe - ((365 * yoe) + (yoe / 4) - (yoe / 100));
+    mp = ((5 * doy) + 2) / 153;
+    *day = (int) (doy - (((153 * mp) + 2) / 5) + 1);
+    *month = (int) (mp < 10 ? mp + 3 : mp - 9);
+    *year = (int) (yoe + (era * 400) + (*month <= 2 ? 1 : 0));
+}
+
+/* find the start and end of the day that a time stamp is in, and its date -
+ * returns 0 if the day can't be calculated this way (before 1972, when the
+ * length of a day in TT2000 wasn't a whole number of seconds), 1 otherwise */
+static int find_day (long long tt2000, struct IMCDFDateTime *date_time, 
+                     long long *day_start, long long *day_end)
+{
+    int year, month, day;
+    double d_year, d_month, d_day, d_hour, d_min, d_sec;
+
+    /* fill and pad values are left to the CDF library */
+    if (tt2000 <= ILLEGAL_TT2000_VALUE) return 0;
+    breakdownTT2000 (tt2000, &d_year, &d_month, &d_day,
+                     &d_hour, &d_min, &d_sec, TT2000NULL);
+    if (d_year < LEAP_SECONDS_START_YEAR) return 0;
+    date_time->year = (int) d_year;
+    date_time->month = (int) d_month;
+    date_time->day = (int) d_day;
+    civil_from_days (days_from_civil (date_time->year, date_time->month, date_time->day) +1, 
+                     &year, &month, &day);
+    if (imcdf_date_time_to_tt2000 (date_time->year, date_time->month, date_time->day, 
+                                   0, 0, 0, day_start) ||
+        imcdf_date_time_to_tt2000 (year, month, day, 0, 0, 0, day_end))
+        return 0;
+    return 1;
+}
+
+/* write a positive number as a fixed number of digits, with leading zeros */
+static void put_digits (char *buffer, int value, int n_digits)
+{
+    while (n_digits > 0)
+    {
+        buffer [-- n_digits] = (char) ('0' + (value % 10));
+        value /= 10;
+    }
+}
+
+/* allocate memory from an arena, or with malloc () if there is no arena */
+static void *arena_or_malloc (struct IMCDFArena *arena, size_t size)
+{
+    if (arena) return imcdf_arena_alloc (arena, size);
+    return malloc (size);
+}
+
 /* find a global attribute - if it doesn't exist create it */
 static long find_global_attribute (int cdf_handle, char *name)
 {
     long attr_num;
     
-    attr_num = CDFattrNum (cdf_ids [cdf_handle], name);
+    attr_num = get_attr_num (cdf_handle, name);
     if (attr_num < 0)
     {
-        cdf_status = CDFcreateAttr (cdf_ids [cdf_handle], name, GLOBAL_SCOPE, &attr_num);
+        cdf_status = CDFcreateAttr (OPEN_CDF (cdf_handle).id, name, GLOBAL_SCOPE, &attr_num);
         if (cdf_status < CDF_WARN) return -1;
+        update_name_cache (cdf_handle, NAME_CACHE_ATTRIBUTE, name, attr_num);
     }
     return attr_num;
 }
@@ -1096,12 +2747,408 @@ static long find_variable_attribute (int cdf_handle, char *name)
 {
     long attr_num;
     
-    attr_num = CDFgetAttrNum (cdf_ids [cdf_handle], name);
+    attr_num = get_attr_num (cdf_handle, name);
     if (attr_num < 0)
     {
-        cdf_status = CDFcreateAttr (cdf_ids [cdf_handle], name, VARIABLE_SCOPE, &attr_num);
+        cdf_status = CDFcreateAttr (OPEN_CDF (cdf_handle).id, name, VARIABLE_SCOPE, &attr_num);
         if (cdf_status < CDF_WARN) return -1l;
+        update_name_cache (cdf_handle, NAME_CACHE_ATTRIBUTE, name, attr_num);
     }
     return attr_num;
 }
 
+/* find the number of a variable or an attribute, using the name cache
+ * if possible - returns a negative status code if the name is not found */
+static long get_var_num (int cdf_handle, char *name)
+{
+    long var_num;
+    struct NameCacheEntry *entry;
+
+    entry = find_name_cache_entry (cdf_handle, NAME_CACHE_VARIABLE, name);
+    if (entry && entry->name [0]) return entry->number;
+    var_num = CDFgetVarNum (OPEN_CDF (cdf_handle).id, name);
+    update_name_cache (cdf_handle, NAME_CACHE_VARIABLE, name, var_num);
+    return var_num;
+}
+
+static long get_attr_num (int cdf_handle, char *name)
+{
+    long attr_num;
+    struct NameCacheEntry *entry;
+
+    entry = find_name_cache_entry (cdf_handle, NAME_CACHE_ATTRIBUTE, name);
+    if (entry && entry->name [0]) return entry->number;
+    attr_num = CDFgetAttrNum (OPEN_CDF (cdf_handle).id, name);
+    update_name_cache (cdf_handle, NAME_CACHE_ATTRIBUTE, name, attr_num);
+    return attr_num;
+}
+
+/* empty the name cache */
+static void clear_name_cache (int cdf_handle)
+{
+    int count;
+
+    for (count=0; count<NAME_CACHE_SIZE; count++)
+        OPEN_CDF (cdf_handle).name_cache [count].name [0] = '\0';
+}
+
+/* record the number of a variable or an attribute in the name cache, replacing
+ * any existing entry for the name - this must be called whenever a variable 
+ * or attribute is created */
+static void update_name_cache (int cdf_handle, char type, char *name, long number)
+{
+    struct NameCacheEntry *entry;
+
+    entry = find_name_cache_entry (cdf_handle, type, name);
+    if (! entry) return;
+    entry->type = type;
+    strcpy (entry->name, name);
+    entry->number = number;
+}
+
+/* find the entry in the name cache that holds a name or, if the name is 
+ * not in the cache, the empty entry where it should be stored - returns
+ * null if the name can't be cached */
+static struct NameCacheEntry *find_name_cache_entry (int cdf_handle, char type, char *name)
+{
+    int count;
+    unsigned long hash;
+    char *ptr;
+    struct NameCacheEntry *entry;
+
+    if (strlen (name) >= NAME_CACHE_NAME_LEN) return 0;
+
+    /* FNV-1a hash of the type and name */
+    hash = 2166136261ul ^ (unsigned char) type;
+    hash *= 16777619ul;
+    for (ptr = name; *ptr; ptr++)
+    {
+        hash ^= (unsigned char) *ptr;
+        hash *= 16777619ul;
+    }
+
+    for (count=0; count<NAME_CACHE_SIZE; count++)
+    {
+        entry = OPEN_CDF (cdf_handle).name_cache + ((hash + count) % NAME_CACHE_SIZE);
+        if (! entry->name [0]) return entry;
+        if (entry->type == type && ! strcmp (entry->name, name)) return entry;
+    }
+    return 0;
+}
+
+/* append data to a variable in a streaming session */
+static int stream_append (int cdf_handle, char *name, long data_type, 
+                          void *data, int data_length, size_t rec_size)
+{
+    int count;
+    long var_num, n_recs;
+    struct StreamSession *stream;
+    struct StreamVar *stream_var, *new_vars;
+
+    if (sanity_check_handles (cdf_handle)) return -1;
+    stream = OPEN_CDF (cdf_handle).stream;
+    if (! stream)
+    {
+        cdf_status = BAD_ARGUMENT;
+        return -1;
+    }
+
+    /* find the variable in the session, adding it if it isn't there */
+    var_num = get_var_num (cdf_handle, name);
+    if (var_num < 0l)
+    {
+        cdf_status = (CDFstatus) var_num;
+        return -1;
+    }
+    stream_var = 0;
+    for (count=0; count<stream->n_vars; count++)
+    {
+        if (stream->vars [count].var_num == var_num) 
+            stream_var = stream->vars + count;
+    }
+    if (! stream_var)
+    {
+        if (check_var (cdf_handle, name, data_type, &var_num, &n_recs)) return -1;
+        new_vars = realloc (stream->vars, sizeof (struct StreamVar) * (stream->n_vars +1));
+        if (! new_vars)
+        {
+            cdf_status = BAD_MALLOC;
+            return -1;
+        }
+        stream->vars = new_vars;
+        stream_var = stream->vars + stream->n_vars;
+        stream_var->buffer = malloc (rec_size * stream->flush_records);
+        if (! stream_var->buffer)
+        {
+            cdf_status = BAD_MALLOC;
+            return -1;
+        }
+        stream_var->var_num = var_num;
+        stream_var->next_rec = n_recs;
+        stream_var->rec_size = rec_size;
+        stream_var->n_buffered = 0;
+        stream->n_vars ++;
+    }
+    if (stream_var->rec_size != rec_size)
+    {
+        cdf_status = BAD_ARGUMENT;
+        return -1;
+    }
+
+    /* all writing is done before any of the new data is taken, so that
+     * on failure none of it has been buffered or written. First check
+     * whether it's time to write everything out, then make room for the
+     * new data */
+    if (stream->flush_seconds > 0 && 
+        difftime (time (0), stream->last_flush) >= (double) stream->flush_seconds)
+    {
+        if (imcdf_stream_flush (cdf_handle)) return -1;
+    }
+    if (stream_var->n_buffered + data_length > stream->flush_records)
+    {
+        if (stream_flush_var (cdf_handle, stream_var)) return -1;
+    }
+
+    /* data that would fill the buffer on its own is written directly */
+    if (data_length >= stream->flush_records)
+    {
+        if (put_records (cdf_handle, stream_var->var_num, stream_var->next_rec,
+                         data, data_length, rec_size))
+            return -1;
+        stream_var->next_rec += data_length;
+    }
+    else if (data_length > 0)
+    {
+        memcpy (stream_var->buffer + (stream_var->n_buffered * rec_size), data, data_length * rec_size);
+        stream_var->n_buffered += data_length;
+    }
+    return 0;
+}
+
+/* append records to the end of a variable - if the variable is in a
+ * streaming session its buffered data is written first and the session
+ * is moved past the new records, so that the two kinds of append can be
+ * mixed without one overwriting the other */
+static int append_records (int cdf_handle, char *name, void *data, int data_length,
+                           size_t rec_size)
+{
+    int count;
+    long var_num, n_recs;
+    struct StreamSession *stream;
+    struct StreamVar *stream_var;
+
+    var_num = get_var_num (cdf_handle, name);
+    if (var_num < 0)
+    {
+        cdf_status = var_num;
+        return -1;
+    }
+
+    stream_var = 0;
+    stream = OPEN_CDF (cdf_handle).stream;
+    if (stream)
+    {
+        for (count=0; count<stream->n_vars; count++)
+        {
+            if (stream->vars [count].var_num == var_num)
+                stream_var = stream->vars + count;
+        }
+        if (stream_var && stream_flush_var (cdf_handle, stream_var)) return -1;
+    }
+
+    cdf_status = CDFgetzVarMaxWrittenRecNum (OPEN_CDF (cdf_handle).id, var_num, &n_recs);
+    if (cdf_status != CDF_OK) return -1;
+    n_recs ++;
+
+    if (put_records (cdf_handle, var_num, n_recs, data, data_length, rec_size)) return -1;
+    if (stream_var) stream_var->next_rec = n_recs + data_length;
+    return 0;
+}
+
+/* write the buffered data for one variable in a streaming session */
+static int stream_flush_var (int cdf_handle, struct StreamVar *stream_var)
+{
+    if (stream_var->n_buffered <= 0) return 0;
+    if (put_records (cdf_handle, stream_var->var_num, stream_var->next_rec,
+                     stream_var->buffer, stream_var->n_buffered, stream_var->rec_size))
+        return -1;
+    stream_var->next_rec += stream_var->n_buffered;
+    stream_var->n_buffered = 0;
+    return 0;
+}
+
+/* free the memory used by a streaming session, discarding any buffered data */
+static void free_stream (int cdf_handle)
+{
+    int count;
+    struct StreamSession *stream;
+
+    stream = OPEN_CDF (cdf_handle).stream;
+    if (! stream) return;
+    for (count=0; count<stream->n_vars; count++)
+        free (stream->vars [count].buffer);
+    if (stream->vars) free (stream->vars);
+    free (stream);
+    OPEN_CDF (cdf_handle).stream = 0;
+}
+
+/* write a block of records to a variable - records are passed to the CDF
+ * library in chunks using the hyper put interface, or one at a time if the
+ * chunk size for this CDF is 0 */
+static int put_records (int cdf_handle, long var_num, long first_rec,
+                        void *data, long n_recs, size_t rec_size)
+{
+    long count, chunk_size, n_chunk_recs;
+    long indices [1], counts [1], intervals [1];
+    char *ptr;
+
+    ptr = (char *) data;
+    chunk_size = OPEN_CDF (cdf_handle).write_chunk_size;
+    if (chunk_size <= 0)
+    {
+        for (count=0; count<n_recs; count++)
+        {
+            cdf_status = CDFputzVarRecordData (OPEN_CDF (cdf_handle).id, var_num, first_rec + count, 
+                                               ptr + (count * rec_size));
+            if (cdf_status < CDF_WARN) return -1;
+        }
+        return 0;
+    }
+
+    indices [0] = 0l;
+    counts [0] = 1l;
+    intervals [0] = 1l;
+    for (count=0; count<n_recs; count+=n_chunk_recs)
+    {
+        n_chunk_recs = n_recs - count;
+        if (n_chunk_recs > chunk_size) n_chunk_recs = chunk_size;
+        cdf_status = CDFhyperPutzVarData (OPEN_CDF (cdf_handle).id, var_num, first_rec + count, n_chunk_recs, 1l,
+                                          indices, counts, intervals, ptr + (count * rec_size));
+        if (cdf_status < CDF_WARN) return -1;
+    }
+    return 0;
+}
+
+/* read a block of records from a variable - records are requested from the
+ * CDF library in chunks using the hyper get interface, or one at a time if
+ * the read chunk size for this CDF is 0 */
+static int get_records (int cdf_handle, long var_num, long first_rec,
+                        void *data, long n_recs, size_t rec_size)
+{
+    long count, chunk_size, n_chunk_recs;
+    long indices [1], counts [1], intervals [1];
+    char *ptr;
+
+    ptr = (char *) data;
+    chunk_size = OPEN_CDF (cdf_handle).read_chunk_size;
+    if (chunk_size <= 0)
+    {
+        for (count=0; count<n_recs; count++)
+        {
+            cdf_status = CDFgetzVarRecordData (OPEN_CDF (cdf_handle).id, var_num, first_rec + count, 
+                                               ptr + (count * rec_size));
+            if (cdf_status < 0) return -1;
+        }
+        return 0;
+    }
+
+    indices [0] = 0l;
+    counts [0] = 1l;
+    intervals [0] = 1l;
+    for (count=0; count<n_recs; count+=n_chunk_recs)
+    {
+        n_chunk_recs = n_recs - count;
+        if (n_chunk_recs > chunk_size) n_chunk_recs = chunk_size;
+        cdf_status = CDFhyperGetzVarData (OPEN_CDF (cdf_handle).id, var_num, first_rec + count, n_chunk_recs, 1l,
+                                          indices, counts, intervals, ptr + (count * rec_size));
+        if (cdf_status < 0) return -1;
+    }
+    return 0;
+}
+
+/* find a variable, check that it holds scalar records of the given type and
+ * get its variable number and the number of records written to it */
+static int check_var (int cdf_handle, char *var_name, long data_type, 
+                      long *var_num, long *n_recs)
+{
+    long var_data_type, num_elements, num_dims, dim_sizes [CDF_MAX_DIMS];
+    long rec_variance, dim_variance [CDF_MAX_DIMS];
+    char local_var_name [CDF_VAR_NAME_LEN256 +1];
+
+    *var_num = get_var_num (cdf_handle, var_name);
+    if (*var_num < 0l)
+    {
+        cdf_status = (CDFstatus) *var_num;
+        return -1;
+    }
+    
+    cdf_status = CDFinquirezVar (OPEN_CDF (cdf_handle).id, *var_num, local_var_name,
+                                 &var_data_type, &num_elements, &num_dims, dim_sizes,
+                                 &rec_variance, dim_variance);
+    if (cdf_status < 0) return -1;
+    if (var_data_type != data_type) return -1;
+    if (num_dims != 0) return -1;
+    
+    cdf_status = CDFgetzVarNumRecsWritten (OPEN_CDF (cdf_handle).id, *var_num, n_recs);
+    if (cdf_status != CDF_OK) return -1;
+    return 0;
+}
+
+/* read a single time stamp */
+static int get_time_stamp (int cdf_handle, long var_num, long rec_num, long long *tt2000)
+{
+    cdf_status = CDFgetzVarRecordData (OPEN_CDF (cdf_handle).id, var_num, rec_num, tt2000);
+    if (cdf_status < 0) return -1;
+    return 0;
+}
+
+/* check that a record is the boundary of a time range - for the start of
+ * the range this is the first record at or after the given time, for the
+ * end of the range the last record at or before the given time - returns
+ * 0 if the record is the boundary, -1 otherwise */
+static int check_range_boundary (int cdf_handle, long var_num, long n_recs,
+                                 long rec_num, long long tt2000, int is_start)
+{
+    long long tt2000_here, tt2000_next;
+
+    if (rec_num < 0 || rec_num >= n_recs) return -1;
+    if (get_time_stamp (cdf_handle, var_num, rec_num, &tt2000_here)) return -1;
+    if (is_start)
+    {
+        if (tt2000_here < tt2000) return -1;
+        if (rec_num == 0) return 0;
+        if (get_time_stamp (cdf_handle, var_num, rec_num -1, &tt2000_next)) return -1;
+        if (tt2000_next >= tt2000) return -1;
+    }
+    else
+    {
+        if (tt2000_here > tt2000) return -1;
+        if (rec_num == n_recs -1) return 0;
+        if (get_time_stamp (cdf_handle, var_num, rec_num +1, &tt2000_next)) return -1;
+        if (tt2000_next <= tt2000) return -1;
+    }
+    return 0;
+}
+
+/* binary search of a time stamp variable - returns the first record whose 
+ * time stamp is at or after (is_start true) or after (is_start false) the 
+ * given time, n_recs if there is no such record, or -2 on failure */
+static long search_time_stamps (int cdf_handle, long var_num, long n_recs,
+                                long long tt2000, int is_start)
+{
+    long low, high, mid;
+    long long tt2000_mid;
+
+    low = 0;
+    high = n_recs;
+    while (low < high)
+    {
+        mid = low + ((high - low) / 2);
+        if (get_time_stamp (cdf_handle, var_num, mid, &tt2000_mid)) return -2;
+        if (tt2000_mid < tt2000 || (! is_start && tt2000_mid == tt2000))
+            low = mid +1;
+        else
+            high = mid;
+    }
+    return low;
+}
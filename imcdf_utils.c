@@ -14,8 +14,15 @@
 #include <time.h>
 #include <math.h>
 #include <ctype.h>
+#include <unistd.h>
  
 #include "imcdf.h"
+
+/* the number of rows of time stamps converted to strings at once */
+#define TEXT_TIME_STAMP_ROWS    256
+
+/* private forward declarations */
+static int format_fixed_sprintf (double value, int decimals, char *buffer);
  
  /*****************************************************************************
   * imcdf_parse_pub_level_string
@@ -268,7 +275,10 @@ void imcdf_print_global_attrs (struct IMCDFGlobalAttr *global_attrs)
 
 void imcdf_print_variable (struct IMCDFVariable *variable, struct IMCDFVariableTS *time_stamps)
 {
-    int count;
+    int count, n_rows, row;
+    long long time_stamp_buffer [TEXT_TIME_STAMP_ROWS];
+    char time_strings [TEXT_TIME_STAMP_ROWS * IMCDF_TT2000_STRING_LEN];
+    struct IMCDFTextWriter writer;
 
     printf ("ImagCDF Variable %s %s\n",
             imcdf_var_type_code_tostring (variable->var_type), variable->elem_rec);
@@ -281,16 +291,246 @@ void imcdf_print_variable (struct IMCDFVariable *variable, struct IMCDFVariableT
     printf ("    Data length: %d\n", variable->data_len);
     printf ("    Time stamps from: %s\n", time_stamps->var_name);
 
-    for (count=0; count<variable->data_len; count++)
+    imcdf_text_writer_init (&writer, stdout, -1);
+    for (count=0; count<variable->data_len; count+=n_rows)
     {
-        if (count < time_stamps->data_len)
-            printf ("      %s ", imcdf_tt2000_tostring (*(time_stamps->time_stamps + count)));
-        else
-            printf ("      Missing time stamp ");
+        n_rows = variable->data_len - count;
+        if (n_rows > TEXT_TIME_STAMP_ROWS) n_rows = TEXT_TIME_STAMP_ROWS;
+        for (row=0; row<n_rows && count + row < time_stamps->data_len; row++)
+            time_stamp_buffer [row] = imcdf_get_time_stamp (time_stamps, count + row);
+        imcdf_tt2000_to_string_array (time_stamp_buffer, row, time_strings);
+
+        for (row=0; row<n_rows; row++)
+        {
+            imcdf_text_write (&writer, "      ", 6);
+            if (count + row < time_stamps->data_len)
+            {
+                imcdf_text_write (&writer, time_strings + (row * IMCDF_TT2000_STRING_LEN), 19);
+                imcdf_text_write (&writer, " ", 1);
+            }
+            else
+                imcdf_text_write (&writer, "Missing time stamp ", 19);
+            imcdf_text_write_number (&writer, *(variable->data + count + row), 3);
+            imcdf_text_write (&writer, "\n", 1);
+        }
+    }
+    imcdf_text_writer_flush (&writer);
+}
 
-        printf ("%.3f\n", *(variable->data + count));
+/*******************************************************************
+ * imcdf_text_writer_init
+ * imcdf_text_write
+ * imcdf_text_write_number
+ * imcdf_text_writer_flush
+ *
+ * Description: buffered writing of text to a stream or a file descriptor -
+ *              text is only passed on when the buffer fills or when
+ *              imcdf_text_writer_flush () is called, which must be done
+ *              before the stream or file descriptor is closed
+ *
+ * Input parameters: writer - the writer
+ *                   file - the stream to write to, or null to write to fd
+ *                   fd - the file descriptor to write to
+ *                   text - the text to write
+ *                   length - the length of the text (or -1 to use strlen)
+ *                   value - a number to write
+ *                   decimals - the number of decimal places to write
+ * Output paramters: none
+ * Returns: 0 for success, -1 if a write failed - once a write has failed
+ *          all further writes fail
+ *******************************************************************/
+void imcdf_text_writer_init (struct IMCDFTextWriter *writer, FILE *file, int fd)
+{
+    writer->file = file;
+    writer->fd = fd;
+    writer->used = 0;
+    writer->error = 0;
+}
+
+int imcdf_text_write (struct IMCDFTextWriter *writer, const char *text, int length)
+{
+    int n_bytes;
+
+    if (length < 0) length = (int) strlen (text);
+    while (length > 0)
+    {
+        if (writer->used >= IMCDF_TEXT_BUFFER_SIZE)
+        {
+            if (imcdf_text_writer_flush (writer)) return -1;
+        }
+        n_bytes = IMCDF_TEXT_BUFFER_SIZE - writer->used;
+        if (n_bytes > length) n_bytes = length;
+        memcpy (writer->buffer + writer->used, text, n_bytes);
+        writer->used += n_bytes;
+        text += n_bytes;
+        length -= n_bytes;
+    }
+    return writer->error ? -1 : 0;
+}
+
+int imcdf_text_write_number (struct IMCDFTextWriter *writer, double value, int decimals)
+{
+    if (writer->used > IMCDF_TEXT_BUFFER_SIZE - IMCDF_NUMBER_STRING_LEN)
+    {
+        if (imcdf_text_writer_flush (writer)) return -1;
     }
+    writer->used += imcdf_format_fixed (value, decimals, writer->buffer + writer->used);
+    return writer->error ? -1 : 0;
 }
 
+int imcdf_text_writer_flush (struct IMCDFTextWriter *writer)
+{
+    int offset;
+    ssize_t n_bytes;
 
+    if (writer->error) return -1;
+    if (writer->file)
+    {
+        if (fwrite (writer->buffer, 1, writer->used, writer->file) != (size_t) writer->used)
+            writer->error = 1;
+    }
+    else
+    {
+        for (offset=0; offset<writer->used; offset+=(int) n_bytes)
+        {
+            n_bytes = write (writer->fd, writer->buffer + offset, writer->used - offset);
+            if (n_bytes <= 0)
+            {
+                writer->error = 1;
+                break;
+            }
+        }
+    }
+    writer->used = 0;
+    return writer->error ? -1 : 0;
+}
 
+/*******************************************************************
+ * imcdf_format_fixed
+ *
+ * Description: format a number with a fixed number of decimal places - the
+ *              result is the same as sprintf's "%.*f", but the common cases
+ *              are formatted without the overhead of sprintf
+ *
+ * Input parameters: value - the number to format
+ *                   decimals - the number of decimal places
+ * Output paramters: buffer - space for the formatted number, at least
+ *                            IMCDF_NUMBER_STRING_LEN bytes - very large
+ *                            numbers are truncated to fit
+ * Returns: the length of the formatted number
+ *******************************************************************/
+int imcdf_format_fixed (double value, int decimals, char *buffer)
+{
+    static const double powers [] = { 1.0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 
+                                       1.0e5, 1.0e6, 1.0e7, 1.0e8, 1.0e9 };
+    int length, n_digits, count;
+    double scaled, whole, fraction;
+    unsigned long long digits;
+    char reversed [24];
+
+    if (decimals < 0 || decimals > 9 || ! isfinite (value))
+        return format_fixed_sprintf (value, decimals, buffer);
+    scaled = fabs (value) * powers [decimals];
+    if (scaled >= 1.0e12) 
+        return format_fixed_sprintf (value, decimals, buffer);
+    /* near a half the multiplication may have rounded the wrong way */
+    whole = floor (scaled);
+    fraction = scaled - whole;
+    if (fabs (fraction - 0.5) < 1.0e-3)
+        return format_fixed_sprintf (value, decimals, buffer);
+    digits = (unsigned long long) whole + (fraction > 0.5 ? 1 : 0);
+
+    n_digits = 0;
+    do
+    {
+        reversed [n_digits ++] = (char) ('0' + (digits % 10));
+        digits /= 10;
+    } while (digits > 0 || n_digits <= decimals);
+
+    length = 0;
+    if (signbit (value)) buffer [length ++] = '-';
+    for (count=n_digits -1; count>=0; count--)
+    {
+        buffer [length ++] = reversed [count];
+        if (count == decimals && count > 0) buffer [length ++] = '.';
+    }
+    buffer [length] = '\0';
+    return length;
+}
+
+/*******************************************************************
+ * imcdf_write_variables_text
+ *
+ * Description: write variables that share a time axis as columns of text -
+ *              a heading line gives the element code of each column,
+ *              followed by one line per time stamp with the time stamp and
+ *              the value of each variable at that time. Variables with 
+ *              fewer samples than the time axis are padded with their
+ *              fill value
+ *
+ * Input parameters: writer - the writer to send the text to
+ *                   variables - the variables to write
+ *                   n_variables - the number of variables
+ *                   time_stamps - the time stamps shared by the variables
+ *                   decimals - the number of decimal places to write
+ * Output paramters: none
+ * Returns: 0 for success, -1 if a write failed
+ *******************************************************************/
+int imcdf_write_variables_text (struct IMCDFTextWriter *writer, 
+                                struct IMCDFVariable **variables, int n_variables,
+                                struct IMCDFVariableTS *time_stamps, int decimals)
+{
+    int count, n_rows, row, var_count;
+    long long time_stamp_buffer [TEXT_TIME_STAMP_ROWS], *time_stamp_ptr;
+    char time_strings [TEXT_TIME_STAMP_ROWS * IMCDF_TT2000_STRING_LEN];
+    struct IMCDFVariable *variable;
+
+    imcdf_text_write (writer, "Time stamp         ", 19);
+    for (var_count=0; var_count<n_variables; var_count++)
+    {
+        imcdf_text_write (writer, " ", 1);
+        imcdf_text_write (writer, (*(variables + var_count))->elem_rec, -1);
+    }
+    imcdf_text_write (writer, "\n", 1);
+
+    for (count=0; count<time_stamps->data_len; count+=n_rows)
+    {
+        n_rows = time_stamps->data_len - count;
+        if (n_rows > TEXT_TIME_STAMP_ROWS) n_rows = TEXT_TIME_STAMP_ROWS;
+        if (time_stamps->time_stamps)
+            time_stamp_ptr = time_stamps->time_stamps + count;
+        else
+        {
+            for (row=0; row<n_rows; row++)
+                time_stamp_buffer [row] = imcdf_get_time_stamp (time_stamps, count + row);
+            time_stamp_ptr = time_stamp_buffer;
+        }
+        imcdf_tt2000_to_string_array (time_stamp_ptr, n_rows, time_strings);
+
+        for (row=0; row<n_rows; row++)
+        {
+            imcdf_text_write (writer, time_strings + (row * IMCDF_TT2000_STRING_LEN), 19);
+            for (var_count=0; var_count<n_variables; var_count++)
+            {
+                variable = *(variables + var_count);
+                imcdf_text_write (writer, " ", 1);
+                if (count + row < variable->data_len)
+                    imcdf_text_write_number (writer, *(variable->data + count + row), decimals);
+                else
+                    imcdf_text_write_number (writer, variable->fill_val, decimals);
+            }
+            if (imcdf_text_write (writer, "\n", 1)) return -1;
+        }
+    }
+    return 0;
+}
+
+/* format a number using sprintf, truncating it if it is too long */
+static int format_fixed_sprintf (double value, int decimals, char *buffer)
+{
+    int length;
+
+    length = snprintf (buffer, IMCDF_NUMBER_STRING_LEN, "%.*f", decimals, value);
+    if (length >= IMCDF_NUMBER_STRING_LEN) length = IMCDF_NUMBER_STRING_LEN -1;
+    return length;
+}